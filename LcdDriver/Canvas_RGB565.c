@@ -0,0 +1,324 @@
+//*****************************************************************************
+//
+// Canvas_RGB565.c - Display driver for an off-screen RGB565 canvas in memory.
+//
+// The canvas is a Graphics_Display like the panel, so a Graphics_Context can
+// draw into it with the usual grlib calls. The finished canvas is sent to the
+// panel in one window write with Crystalfontz128x128_Blit().
+//
+//*****************************************************************************
+
+#include <ti/grlib/grlib.h>
+#include "Canvas_RGB565.h"
+#include <stdint.h>
+
+#define CANVAS_PIXEL(pDisplay, lX, lY) \
+    (((uint16_t *)(pDisplay)->displayData) + (int32_t)(lY) * (pDisplay)->width + (lX))
+
+//*****************************************************************************
+//
+// Reads a palette entry as a canvas pixel. Entries are 32-bit words holding
+// a native 16-bit color, used as they are like the panel driver does, so
+// every depth reads them the same way whatever the byte order.
+//
+//*****************************************************************************
+static inline uint16_t Canvas_RGB565_paletteColor(const uint32_t *pucPalette,
+                                                  uint16_t index)
+{
+    return CANVAS_BUS_ORDER((uint16_t)pucPalette[index]);
+}
+
+//*****************************************************************************
+//
+//! Sets up a canvas display.
+//!
+//! \param canvas is the display structure to fill in.
+//! \param pixels is the memory for the canvas, width * height pixels.
+//! \param width is the width of the canvas in pixels.
+//! \param height is the height of the canvas in pixels.
+//!
+//! The canvas can be set up again with another size on the same memory, as
+//! long as it still fits.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void Canvas_RGB565_init(Graphics_Display *canvas, uint16_t *pixels,
+                        uint16_t width, uint16_t height)
+{
+    canvas->size = sizeof(Graphics_Display);
+    canvas->displayData = pixels;
+    canvas->width = width;
+    canvas->heigth = height;
+}
+
+//*****************************************************************************
+//
+//! Draws a pixel on the canvas.
+//!
+//! \param pDisplay is a pointer to the canvas.
+//! \param lX is the X coordinate of the pixel.
+//! \param lY is the Y coordinate of the pixel.
+//! \param ulValue is the color of the pixel.
+//!
+//! \return None.
+//
+//*****************************************************************************
+static void Canvas_RGB565_PixelDraw(const Graphics_Display *pDisplay,
+                                    int16_t lX,
+                                    int16_t lY,
+                                    uint16_t ulValue)
+{
+    *CANVAS_PIXEL(pDisplay, lX, lY) = CANVAS_BUS_ORDER(ulValue);
+}
+
+//*****************************************************************************
+//
+//! Draws a horizontal sequence of pixels on the canvas.
+//!
+//! \param pDisplay is a pointer to the canvas.
+//! \param lX is the X coordinate of the first pixel.
+//! \param lY is the Y coordinate of the first pixel.
+//! \param lX0 is sub-pixel offset within the pixel data, which is valid for 1
+//! or 4 bit per pixel formats.
+//! \param lCount is the number of pixels to draw.
+//! \param lBPP is the number of bits per pixel; must be 1, 4, 8 or 16.
+//! \param pucData is a pointer to the pixel data.  For 1 and 4 bit per pixel
+//! formats, the most significant bit(s) represent the left-most pixel.
+//! \param pucPalette is a pointer to the palette used to draw the pixels.
+//!
+//! The palette is used the same way as by the panel driver, so images look
+//! the same drawn either way. Pixels past the right edge are dropped.
+//!
+//! \return None.
+//
+//*****************************************************************************
+static void Canvas_RGB565_PixelDrawMultiple(const Graphics_Display *pDisplay,
+                                            int16_t lX,
+                                            int16_t lY,
+                                            int16_t lX0,
+                                            int16_t lCount,
+                                            int16_t lBPP,
+                                            const uint8_t *pucData,
+                                            const uint32_t *pucPalette)
+{
+    uint16_t *out = CANVAS_PIXEL(pDisplay, lX, lY);
+    uint16_t Data;
+
+    if (lCount > pDisplay->width - lX)
+        lCount = pDisplay->width - lX;
+
+    switch(lBPP)
+    {
+        // The pixel data is in 1 bit per pixel format
+        case 1:
+        {
+            while(lCount > 0)
+            {
+                Data = *pucData++;
+
+                for(; (lX0 < 8) && lCount; lX0++, lCount--)
+                {
+                    *out++ = Canvas_RGB565_paletteColor(pucPalette, (Data >> (7 - lX0)) & 1);
+                }
+
+                lX0 = 0;
+            }
+            break;
+        }
+
+        // The pixel data is in 4 bit per pixel format
+        case 4:
+        {
+            if((lX0 & 1) && lCount)
+            {
+                // Start on the lower nibble of the first byte
+                Data = (*pucData++ & 15);
+                *out++ = Canvas_RGB565_paletteColor(pucPalette, Data);
+                lCount--;
+            }
+            while(lCount)
+            {
+                Data = (*pucData >> 4);
+                *out++ = Canvas_RGB565_paletteColor(pucPalette, Data);
+                lCount--;
+
+                if(lCount)
+                {
+                    Data = (*pucData++ & 15);
+                    *out++ = Canvas_RGB565_paletteColor(pucPalette, Data);
+                    lCount--;
+                }
+            }
+            break;
+        }
+
+        // The pixel data is in 8 bit per pixel format
+        case 8:
+        {
+            while(lCount-- > 0)
+            {
+                Data = *pucData++;
+                *out++ = Canvas_RGB565_paletteColor(pucPalette, Data);
+            }
+            break;
+        }
+
+        // The pixel data is already in the display's native format
+        case 16:
+        {
+            while(lCount-- > 0)
+            {
+                Data = *((uint16_t *)pucData);
+                pucData += 2;
+                *out++ = CANVAS_BUS_ORDER(Data);
+            }
+            break;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Draws a horizontal line.
+//!
+//! \param pDisplay is a pointer to the canvas.
+//! \param lX1 is the X coordinate of the start of the line.
+//! \param lX2 is the X coordinate of the end of the line.
+//! \param lY is the Y coordinate of the line.
+//! \param ulValue is the color of the line.
+//!
+//! \return None.
+//
+//*****************************************************************************
+static void Canvas_RGB565_LineDrawH(const Graphics_Display *pDisplay,
+                                    int16_t lX1,
+                                    int16_t lX2,
+                                    int16_t lY,
+                                    uint16_t ulValue)
+{
+    uint16_t *out = CANVAS_PIXEL(pDisplay, lX1, lY);
+    uint16_t value = CANVAS_BUS_ORDER(ulValue);
+    int16_t i;
+
+    for (i = lX1; i <= lX2; i++)
+        *out++ = value;
+}
+
+//*****************************************************************************
+//
+//! Draws a vertical line.
+//!
+//! \param pDisplay is a pointer to the canvas.
+//! \param lX is the X coordinate of the line.
+//! \param lY1 is the Y coordinate of the start of the line.
+//! \param lY2 is the Y coordinate of the end of the line.
+//! \param ulValue is the color of the line.
+//!
+//! \return None.
+//
+//*****************************************************************************
+static void Canvas_RGB565_LineDrawV(const Graphics_Display *pDisplay,
+                                    int16_t lX,
+                                    int16_t lY1,
+                                    int16_t lY2,
+                                    uint16_t ulValue)
+{
+    uint16_t *out = CANVAS_PIXEL(pDisplay, lX, lY1);
+    uint16_t value = CANVAS_BUS_ORDER(ulValue);
+    int16_t i;
+
+    for (i = lY1; i <= lY2; i++, out += pDisplay->width)
+        *out = value;
+}
+
+//*****************************************************************************
+//
+//! Fills a rectangle.
+//!
+//! \param pDisplay is a pointer to the canvas.
+//! \param pRect is a pointer to the structure describing the rectangle.
+//! \param ulValue is the color of the rectangle.
+//!
+//! The rectangle is fully inclusive and assumed to be within the canvas.
+//!
+//! \return None.
+//
+//*****************************************************************************
+static void Canvas_RGB565_RectFill(const Graphics_Display *pDisplay,
+                                   const Graphics_Rectangle *pRect,
+                                   uint16_t ulValue)
+{
+    int16_t y;
+
+    for (y = pRect->sYMin; y <= pRect->sYMax; y++)
+        Canvas_RGB565_LineDrawH(pDisplay, pRect->sXMin, pRect->sXMax, y, ulValue);
+}
+
+//*****************************************************************************
+//
+//! Translates a 24-bit RGB color to a 5-6-5 RGB color.
+//!
+//! \param pDisplay is a pointer to the canvas.
+//! \param ulValue is the 24-bit RGB color.
+//!
+//! \return Returns the 5-6-5 color, the same as the panel driver gives.
+//
+//*****************************************************************************
+static uint32_t Canvas_RGB565_ColorTranslate(const Graphics_Display *pDisplay,
+                                             uint32_t ulValue)
+{
+    return(((((ulValue) & 0x00f80000) >> 8) |
+            (((ulValue) & 0x0000fc00) >> 5) |
+            (((ulValue) & 0x000000f8) >> 3)));
+}
+
+//*****************************************************************************
+//
+//! Flushes any cached drawing operations.
+//!
+//! \param pDisplay is a pointer to the canvas.
+//!
+//! Nothing is cached, the canvas goes to the panel only when it is blitted.
+//!
+//! \return None.
+//
+//*****************************************************************************
+static void
+Canvas_RGB565_Flush(const Graphics_Display *pDisplay)
+{
+}
+
+//*****************************************************************************
+//
+//! Fills the whole canvas with one color.
+//!
+//! \param pDisplay is a pointer to the canvas.
+//! \param ulValue is the color.
+//!
+//! \return None.
+//
+//*****************************************************************************
+static void
+Canvas_RGB565_ClearScreen(const Graphics_Display *pDisplay,
+                          uint16_t ulValue)
+{
+    uint16_t *out = CANVAS_PIXEL(pDisplay, 0, 0);
+    uint16_t value = CANVAS_BUS_ORDER(ulValue);
+    int32_t i;
+
+    for (i = (int32_t)pDisplay->width * pDisplay->heigth; i > 0; i--)
+        *out++ = value;
+}
+
+const Graphics_Display_Functions g_sCanvasRGB565_funcs =
+{
+    Canvas_RGB565_PixelDraw,
+    Canvas_RGB565_PixelDrawMultiple,
+    Canvas_RGB565_LineDrawH,
+    Canvas_RGB565_LineDrawV,
+    Canvas_RGB565_RectFill,
+    Canvas_RGB565_ColorTranslate,
+    Canvas_RGB565_Flush,
+    Canvas_RGB565_ClearScreen
+};
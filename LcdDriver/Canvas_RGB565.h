@@ -0,0 +1,25 @@
+//*****************************************************************************
+//
+// Canvas_RGB565.h - Display driver for an off-screen RGB565 canvas in memory.
+//
+//*****************************************************************************
+
+#ifndef __CANVAS_RGB565_H__
+#define __CANVAS_RGB565_H__
+
+
+#include <stdint.h>
+#include <ti/grlib/grlib.h>
+
+// Pixels are kept high byte first, the order the ST7735 takes them, so a
+// canvas can be sent to the panel as it is.
+#define CANVAS_BUS_ORDER(v)   ((uint16_t)(((v) << 8) | ((v) >> 8)))
+
+extern const Graphics_Display_Functions g_sCanvasRGB565_funcs;
+
+extern void Canvas_RGB565_init(Graphics_Display *canvas, uint16_t *pixels,
+                               uint16_t width, uint16_t height);
+
+
+
+#endif /* __CANVAS_RGB565_H__ */
@@ -43,105 +43,216 @@
 #include <stdint.h>
 
 uint8_t Lcd_Orientation;
+
 uint16_t Lcd_ScreenWidth, Lcd_ScreenHeigth;
 uint8_t Lcd_PenSolid, Lcd_FontSolid, Lcd_FlagRead;
 uint16_t Lcd_TouchTrim;
 
+// Where the visible 128x128 area starts in the controller RAM, per orientation
+#define OFFSET_UP_X         2
+#define OFFSET_UP_Y         3
+#define OFFSET_LEFT_X       3
+#define OFFSET_LEFT_Y       2
+#define OFFSET_DOWN_X       2
+#define OFFSET_DOWN_Y       1
+#define OFFSET_RIGHT_X      1
+#define OFFSET_RIGHT_Y      2
+
+// Offsets for the current orientation, set by Crystalfontz128x128_SetOrientation()
+static uint16_t frameDx = OFFSET_UP_X, frameDy = OFFSET_UP_Y;
+
+static uint8_t initStep;
+
 //*****************************************************************************
 //
-//! Initializes the display driver.
+//! Starts initializing the display driver.
 //!
-//! This function initializes the ST7735 display controller on the panel,
-//! preparing it to display data.
+//! This function sets up the SPI port and pulls the panel reset low. The rest
+//! of the power-up is done by Crystalfontz128x128_InitStep(), so that other
+//! hardware can be set up while the panel waits.
 //!
 //! \return None.
 //
 //*****************************************************************************
-void Crystalfontz128x128_Init(void)
+void Crystalfontz128x128_InitStart(void)
 {
     HAL_LCD_PortInit();
     HAL_LCD_SpiInit();
 
     GPIO_setOutputLowOnPin(LCD_RST_PORT, LCD_RST_PIN);
-    HAL_LCD_delay(50);
-    GPIO_setOutputHighOnPin(LCD_RST_PORT, LCD_RST_PIN);
-    HAL_LCD_delay(120);
+    HAL_LCD_startDelay(10);
+    initStep = 0;
+}
+
+//*****************************************************************************
+//
+//! Runs the next step of the display power-up.
+//!
+//! Each call returns at once if the panel is still in a wait from the ST7735
+//! datasheet (120ms after reset, 5ms after sleep out), otherwise it sends the
+//! next group of commands.
+//!
+//! \return true once the controller is set up, false while it is not.
+//
+//*****************************************************************************
+bool Crystalfontz128x128_InitStep(void)
+{
+    if (!HAL_LCD_delayDone())
+        return false;
 
-    HAL_LCD_writeCommand(CM_SLPOUT);
-    HAL_LCD_delay(200);
+    switch (initStep)
+    {
+    case 0:
+        GPIO_setOutputHighOnPin(LCD_RST_PORT, LCD_RST_PIN);
+        HAL_LCD_startDelay(120000);
+        break;
+    case 1:
+        HAL_LCD_writeCommand(CM_SLPOUT);
+        HAL_LCD_startDelay(5000);
+        break;
+    case 2:
+        HAL_LCD_writeCommand(CM_GAMSET);
+        HAL_LCD_writeData(0x04);
 
-    HAL_LCD_writeCommand(CM_GAMSET);
-    HAL_LCD_writeData(0x04);
+        HAL_LCD_writeCommand(CM_SETPWCTR);
+        HAL_LCD_writeData(0x0A);
+        HAL_LCD_writeData(0x14);
 
-    HAL_LCD_writeCommand(CM_SETPWCTR);
-    HAL_LCD_writeData(0x0A);
-    HAL_LCD_writeData(0x14);
+        HAL_LCD_writeCommand(CM_SETSTBA);
+        HAL_LCD_writeData(0x0A);
+        HAL_LCD_writeData(0x00);
 
-    HAL_LCD_writeCommand(CM_SETSTBA);
-    HAL_LCD_writeData(0x0A);
-    HAL_LCD_writeData(0x00);
+        HAL_LCD_writeCommand(CM_COLMOD);
+        HAL_LCD_writeData(0x05);
 
-    HAL_LCD_writeCommand(CM_COLMOD);
-    HAL_LCD_writeData(0x05);
-    HAL_LCD_delay(10);
+        HAL_LCD_writeCommand(CM_MADCTL);
+        HAL_LCD_writeData(CM_MADCTL_BGR);
 
-    HAL_LCD_writeCommand(CM_MADCTL);
-    HAL_LCD_writeData(CM_MADCTL_BGR);
+        HAL_LCD_writeCommand(CM_NORON);
 
-    HAL_LCD_writeCommand(CM_NORON);
+        Lcd_ScreenWidth  = LCD_VERTICAL_MAX;
+        Lcd_ScreenHeigth = LCD_HORIZONTAL_MAX;
+        Lcd_PenSolid  = 0;
+        Lcd_FontSolid = 1;
+        Lcd_FlagRead  = 0;
+        Lcd_TouchTrim = 0;
+        break;
+    default:
+        return true;
+    }
 
-    Lcd_ScreenWidth  = LCD_VERTICAL_MAX;
-    Lcd_ScreenHeigth = LCD_HORIZONTAL_MAX;
-    Lcd_PenSolid  = 0;
-    Lcd_FontSolid = 1;
-    Lcd_FlagRead  = 0;
-    Lcd_TouchTrim = 0;
+    initStep++;
+    return false;
+}
 
-    Crystalfontz128x128_SetDrawFrame(0, 0, 127, 127);
-    HAL_LCD_writeCommand(CM_RAMWR);
+//*****************************************************************************
+//
+//! Fills the whole panel with one color.
+//!
+//! \param color is the 16-bit color as it goes on the bus, high byte first.
+//!
+//! One row of pixels is sent by DMA again and again, as the uDMA can not move
+//! more than 1024 bytes in one go.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void Crystalfontz128x128_Fill(uint16_t color)
+{
+    static uint8_t row[LCD_HORIZONTAL_MAX * 2];
     int i;
-    for (i = 0; i < 16384; i++)
+
+    for (i = 0; i < (int)sizeof(row); i += 2)
+    {
+        row[i] = color >> 8;
+        row[i + 1] = color;
+    }
+
+    Crystalfontz128x128_SetDrawFrame(0, 0, LCD_HORIZONTAL_MAX - 1, LCD_VERTICAL_MAX - 1);
+    HAL_LCD_writeCommand(CM_RAMWR);
+    for (i = 0; i < LCD_VERTICAL_MAX; i++)
     {
-        HAL_LCD_writeData(0xFF);
-        HAL_LCD_writeData(0xFF);
+        HAL_LCD_writeDataDMA(row, sizeof(row));
+        HAL_LCD_waitDMA();
     }
+}
 
-    HAL_LCD_delay(10);
+//*****************************************************************************
+//
+//! Turns the panel on, showing what has been drawn so far.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void Crystalfontz128x128_DisplayOn(void)
+{
     HAL_LCD_writeCommand(CM_DISPON);
 }
 
+//*****************************************************************************
+//
+//! Initializes the display driver.
+//!
+//! This function initializes the ST7735 display controller on the panel,
+//! preparing it to display data. It waits for the whole power-up, use
+//! Crystalfontz128x128_InitStart() and Crystalfontz128x128_InitStep() to
+//! do other work meanwhile.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void Crystalfontz128x128_Init(void)
+{
+    Crystalfontz128x128_InitStart();
+    while (!Crystalfontz128x128_InitStep());
 
-void Crystalfontz128x128_SetDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+    Crystalfontz128x128_Fill(0xFFFF);
+    Crystalfontz128x128_DisplayOn();
+}
+
+
+//*****************************************************************************
+//
+// Moves a frame from screen coordinates to controller RAM for the current
+// orientation. Only the generic primitives still look the offsets up on
+// every call.
+//
+//*****************************************************************************
+static void Crystalfontz128x128_OffsetFrame(uint16_t *x0, uint16_t *y0, uint16_t *x1, uint16_t *y1)
 {
+    uint16_t dx = 0, dy = 0;
+
     switch (Lcd_Orientation) {
         case 0:
-            x0 += 2;
-            y0 += 3;
-            x1 += 2;
-            y1 += 3;
+            dx = OFFSET_UP_X;
+            dy = OFFSET_UP_Y;
             break;
         case 1:
-            x0 += 3;
-            y0 += 2;
-            x1 += 3;
-            y1 += 2;
+            dx = OFFSET_LEFT_X;
+            dy = OFFSET_LEFT_Y;
             break;
         case 2:
-            x0 += 2;
-            y0 += 1;
-            x1 += 2;
-            y1 += 1;
+            dx = OFFSET_DOWN_X;
+            dy = OFFSET_DOWN_Y;
             break;
         case 3:
-            x0 += 1;
-            y0 += 2;
-            x1 += 1;
-            y1 += 2;
+            dx = OFFSET_RIGHT_X;
+            dy = OFFSET_RIGHT_Y;
             break;
         default:
             break;
     }
 
+    *x0 += dx;
+    *y0 += dy;
+    *x1 += dx;
+    *y1 += dy;
+}
+
+static void Crystalfontz128x128_SetDrawFrameGeneric(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+    Crystalfontz128x128_OffsetFrame(&x0, &y0, &x1, &y1);
+
     HAL_LCD_writeCommand(CM_CASET);
     HAL_LCD_writeData((uint8_t)(x0 >> 8));
     HAL_LCD_writeData((uint8_t)(x0));
@@ -155,6 +266,96 @@ void Crystalfontz128x128_SetDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uin
     HAL_LCD_writeData((uint8_t)(y1));
 }
 
+//*****************************************************************************
+//
+// Sets a frame already in controller RAM coordinates.
+//
+//*****************************************************************************
+static inline void Crystalfontz128x128_WriteFrame(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+    uint8_t data[4];
+
+    data[0] = x0 >> 8;
+    data[1] = x0;
+    data[2] = x1 >> 8;
+    data[3] = x1;
+    HAL_LCD_writeCommand(CM_CASET);
+    HAL_LCD_writeDataBuffer(data, 4);
+
+    data[0] = y0 >> 8;
+    data[1] = y0;
+    data[2] = y1 >> 8;
+    data[3] = y1;
+    HAL_LCD_writeCommand(CM_RASET);
+    HAL_LCD_writeDataBuffer(data, 4);
+}
+
+void Crystalfontz128x128_SetDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+    Crystalfontz128x128_WriteFrame(x0 + frameDx, y0 + frameDy, x1 + frameDx, y1 + frameDy);
+}
+
+//*****************************************************************************
+//
+//! Queues a draw frame and the RAM write that fills it.
+//!
+//! Like Crystalfontz128x128_SetDrawFrame() followed by CM_RAMWR, but the
+//! commands go on the display list and this returns at once. Pixels for the
+//! frame are queued with HAL_LCD_queueFill() or HAL_LCD_queueBlit().
+//!
+//! \return None.
+//
+//*****************************************************************************
+void Crystalfontz128x128_QueueDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+    uint8_t data[4];
+
+    x0 += frameDx;
+    y0 += frameDy;
+    x1 += frameDx;
+    y1 += frameDy;
+
+    data[0] = x0 >> 8;
+    data[1] = x0;
+    data[2] = x1 >> 8;
+    data[3] = x1;
+    HAL_LCD_queueCommand(CM_CASET, data, 4);
+
+    data[0] = y0 >> 8;
+    data[1] = y0;
+    data[2] = y1 >> 8;
+    data[3] = y1;
+    HAL_LCD_queueCommand(CM_RASET, data, 4);
+
+    HAL_LCD_queueCommand(CM_RAMWR, data, 0);
+}
+
+//*****************************************************************************
+//
+//! Sends a canvas to the panel.
+//!
+//! \param canvas is a canvas display set up by Canvas_RGB565_init().
+//! \param x is the X coordinate of the top left corner on the panel.
+//! \param y is the Y coordinate of the top left corner on the panel.
+//!
+//! The whole canvas goes out as one window write on the display list. It is
+//! read while the list runs, so it must not be drawn into again until the
+//! returned fence is done. The canvas must fit on the panel at x, y.
+//!
+//! \return A display list fence for the transfer.
+//
+//*****************************************************************************
+uint32_t Crystalfontz128x128_Blit(const Graphics_Display *canvas, uint16_t x, uint16_t y)
+{
+    Crystalfontz128x128_QueueDrawFrame(x, y, x + canvas->width - 1, y + canvas->heigth - 1);
+    HAL_LCD_queueBlit((const uint8_t *)canvas->displayData,
+                      (uint32_t)canvas->width * canvas->heigth * 2);
+    return HAL_LCD_queueFence();
+}
+
+
+// Filled in below, once the primitives for each orientation are built
+static const Graphics_Display_Functions *const Crystalfontz128x128_variants[4];
 
 //*****************************************************************************
 //
@@ -166,7 +367,9 @@ void Crystalfontz128x128_SetDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uin
 //!           - \b LCD_ORIENTATION_DOWN,
 //!           - \b LCD_ORIENTATION_RIGHT,
 //!
-//! This function sets the orientation of the LCD
+//! This function sets the orientation of the LCD. It also picks the frame
+//! offsets and fills g_sCrystalfontz128x128_funcs with the primitives built
+//! for this orientation, so nothing is looked up again while drawing.
 //!
 //! \return None.
 //
@@ -178,17 +381,27 @@ void Crystalfontz128x128_SetOrientation(uint8_t orientation)
     switch (Lcd_Orientation) {
         case LCD_ORIENTATION_UP:
             HAL_LCD_writeData(CM_MADCTL_MX | CM_MADCTL_MY | CM_MADCTL_BGR);
+            frameDx = OFFSET_UP_X;
+            frameDy = OFFSET_UP_Y;
             break;
         case LCD_ORIENTATION_LEFT:
             HAL_LCD_writeData(CM_MADCTL_MY | CM_MADCTL_MV | CM_MADCTL_BGR);
+            frameDx = OFFSET_LEFT_X;
+            frameDy = OFFSET_LEFT_Y;
             break;
         case LCD_ORIENTATION_DOWN:
             HAL_LCD_writeData(CM_MADCTL_BGR);
+            frameDx = OFFSET_DOWN_X;
+            frameDy = OFFSET_DOWN_Y;
             break;
         case LCD_ORIENTATION_RIGHT:
             HAL_LCD_writeData(CM_MADCTL_MX | CM_MADCTL_MV | CM_MADCTL_BGR);
+            frameDx = OFFSET_RIGHT_X;
+            frameDy = OFFSET_RIGHT_Y;
             break;
     }
+    if (Lcd_Orientation < 4)
+        g_sCrystalfontz128x128_funcs = *Crystalfontz128x128_variants[Lcd_Orientation];
 }
 
 
@@ -208,13 +421,13 @@ void Crystalfontz128x128_SetOrientation(uint8_t orientation)
 //! \return None.
 //
 //*****************************************************************************
-static void Crystalfontz128x128_PixelDraw(const Graphics_Display *pDisplay,
+static void Crystalfontz128x128_PixelDrawGeneric(const Graphics_Display *pDisplay,
 	                                        int16_t lX,
                                           int16_t lY,
                                           uint16_t ulValue)
 {
 
-    Crystalfontz128x128_SetDrawFrame(lX,lY,lX,lY);
+    Crystalfontz128x128_SetDrawFrameGeneric(lX,lY,lX,lY);
 
     //
     // Write the pixel value.
@@ -250,7 +463,7 @@ static void Crystalfontz128x128_PixelDraw(const Graphics_Display *pDisplay,
 //! \return None.
 //
 //*****************************************************************************
-static void Crystalfontz128x128_PixelDrawMultiple(const Graphics_Display *pDisplay,
+static void Crystalfontz128x128_PixelDrawMultipleGeneric(const Graphics_Display *pDisplay,
                                                   int16_t lX,
                                                   int16_t lY,
                                                   int16_t lX0,
@@ -264,7 +477,7 @@ static void Crystalfontz128x128_PixelDrawMultiple(const Graphics_Display *pDispl
     //
     // Set the cursor increment to left to right, followed by top to bottom.
     //
-    Crystalfontz128x128_SetDrawFrame(lX,lY,lX+lCount,127);
+    Crystalfontz128x128_SetDrawFrameGeneric(lX,lY,lX+lCount,127);
     HAL_LCD_writeCommand(CM_RAMWR);
 
     //
@@ -413,7 +626,7 @@ static void Crystalfontz128x128_PixelDrawMultiple(const Graphics_Display *pDispl
 //! \return None.
 //
 //*****************************************************************************
-static void Crystalfontz128x128_LineDrawH(const Graphics_Display *pDisplay,
+static void Crystalfontz128x128_LineDrawHGeneric(const Graphics_Display *pDisplay,
                                           int16_t lX1,
                                           int16_t lX2,
                                           int16_t lY,
@@ -421,7 +634,7 @@ static void Crystalfontz128x128_LineDrawH(const Graphics_Display *pDisplay,
 {
 
 
-    Crystalfontz128x128_SetDrawFrame(lX1, lY, lX2, lY);
+    Crystalfontz128x128_SetDrawFrameGeneric(lX1, lY, lX2, lY);
 
     //
     // Write the pixel value.
@@ -453,13 +666,13 @@ static void Crystalfontz128x128_LineDrawH(const Graphics_Display *pDisplay,
 //! \return None.
 //
 //*****************************************************************************
-static void Crystalfontz128x128_LineDrawV(const Graphics_Display *pDisplay,
+static void Crystalfontz128x128_LineDrawVGeneric(const Graphics_Display *pDisplay,
                                           int16_t lX,
                                           int16_t lY1,
                                           int16_t lY2,
                                           uint16_t ulValue)
 {
-    Crystalfontz128x128_SetDrawFrame(lX, lY1, lX, lY2);
+    Crystalfontz128x128_SetDrawFrameGeneric(lX, lY1, lX, lY2);
 
     //
     // Write the pixel value.
@@ -491,7 +704,7 @@ static void Crystalfontz128x128_LineDrawV(const Graphics_Display *pDisplay,
 //! \return None.
 //
 //*****************************************************************************
-static void Crystalfontz128x128_RectFill(const Graphics_Display *pDisplay,
+static void Crystalfontz128x128_RectFillGeneric(const Graphics_Display *pDisplay,
                                          const Graphics_Rectangle *pRect,
                                          uint16_t ulValue)
 {
@@ -500,7 +713,7 @@ static void Crystalfontz128x128_RectFill(const Graphics_Display *pDisplay,
     int16_t y0 = pRect->sYMin;
     int16_t y1 = pRect->sYMax;
 
-    Crystalfontz128x128_SetDrawFrame(x0, y0, x1, y1);
+    Crystalfontz128x128_SetDrawFrameGeneric(x0, y0, x1, y1);
 
     //
     // Write the pixel value.
@@ -582,11 +795,11 @@ Crystalfontz128x128_Flush(const Graphics_Display *pDisplay)
 //
 //*****************************************************************************
 static void
-Crystalfontz128x128_ClearScreen (const Graphics_Display *pDisplay,
-                                 uint16_t ulValue)
+Crystalfontz128x128_ClearScreenGeneric (const Graphics_Display *pDisplay,
+                                        uint16_t ulValue)
 {
     Graphics_Rectangle rect = { 0, 0, LCD_VERTICAL_MAX-1, LCD_VERTICAL_MAX-1};
-    Crystalfontz128x128_RectFill(pDisplay, &rect, ulValue);
+    Crystalfontz128x128_RectFillGeneric(pDisplay, &rect, ulValue);
 }
 
 
@@ -604,15 +817,230 @@ Graphics_Display g_sCrystalfontz128x128 =
     LCD_HORIZONTAL_MAX,
 };
 
-const Graphics_Display_Functions g_sCrystalfontz128x128_funcs =
+//*****************************************************************************
+//
+//! The primitives above, with the orientation looked up and the pixel format
+//! switched on in every call, one byte at a time. They are kept to time the
+//! specialized ones against.
+//
+//*****************************************************************************
+const Graphics_Display_Functions g_sCrystalfontz128x128_genericFuncs =
 {
-    Crystalfontz128x128_PixelDraw,
-    Crystalfontz128x128_PixelDrawMultiple,
-    Crystalfontz128x128_LineDrawH,
-    Crystalfontz128x128_LineDrawV,
-    Crystalfontz128x128_RectFill,
+    Crystalfontz128x128_PixelDrawGeneric,
+    Crystalfontz128x128_PixelDrawMultipleGeneric,
+    Crystalfontz128x128_LineDrawHGeneric,
+    Crystalfontz128x128_LineDrawVGeneric,
+    Crystalfontz128x128_RectFillGeneric,
     Crystalfontz128x128_ColorTranslate,
     Crystalfontz128x128_Flush,
-    Crystalfontz128x128_ClearScreen
+    Crystalfontz128x128_ClearScreenGeneric
+};
+
+//*****************************************************************************
+//
+// Specialized primitives
+//
+// Each pixel format has its own run function, generated by
+// CRYSTALFONTZ_PIXEL_RUN from the expression that reads pixel px. Pixels
+// are expanded PIXEL_CHUNK at a time with no branches in the loop, and each
+// chunk goes out with one HAL_LCD_writeDataBuffer() call.
+//
+// The primitives are written once as inline functions on controller RAM
+// coordinates. CRYSTALFONTZ_ORIENTATION instantiates them for one
+// orientation, with its offsets as constants, and builds the function table
+// for it. Crystalfontz128x128_SetOrientation() copies the one in use into
+// g_sCrystalfontz128x128_funcs.
+//
+//*****************************************************************************
+#define PIXEL_CHUNK         32
+
+#define CRYSTALFONTZ_PIXEL_RUN(bpp, pixel)                                    \
+static void Crystalfontz128x128_PixelRun##bpp(int16_t px, int16_t lCount,     \
+                                              const uint8_t *pucData,         \
+                                              const uint32_t *pucPalette)     \
+{                                                                             \
+    uint8_t buffer[PIXEL_CHUNK * 2];                                          \
+    uint16_t value;                                                           \
+    int16_t i, n;                                                             \
+                                                                              \
+    while (lCount > 0)                                                        \
+    {                                                                         \
+        n = (lCount < PIXEL_CHUNK) ? lCount : PIXEL_CHUNK;                    \
+        for (i = 0; i < n; i++, px++)                                         \
+        {                                                                     \
+            value = (pixel);                                                  \
+            buffer[2 * i] = value >> 8;                                       \
+            buffer[2 * i + 1] = value;                                        \
+        }                                                                     \
+        HAL_LCD_writeDataBuffer(buffer, n * 2);                               \
+        lCount -= n;                                                          \
+    }                                                                         \
+}
+
+// Palette entries are used as they are, the same as the generic primitive
+CRYSTALFONTZ_PIXEL_RUN(1, pucPalette[(pucData[px >> 3] >> (7 - (px & 7))) & 1])
+CRYSTALFONTZ_PIXEL_RUN(4, pucPalette[(pucData[px >> 1] >> ((~px & 1) << 2)) & 15])
+CRYSTALFONTZ_PIXEL_RUN(8, pucPalette[pucData[px]])
+CRYSTALFONTZ_PIXEL_RUN(16, ((const uint16_t *)pucData)[px])
+
+//*****************************************************************************
+//
+// Sends count pixels of one color.
+//
+//*****************************************************************************
+static void Crystalfontz128x128_FillRun(uint16_t ulValue, int32_t count)
+{
+    uint8_t buffer[PIXEL_CHUNK * 2];
+    int16_t i;
+
+    for (i = 0; i < PIXEL_CHUNK; i++)
+    {
+        buffer[2 * i] = ulValue >> 8;
+        buffer[2 * i + 1] = ulValue;
+    }
+    while (count > PIXEL_CHUNK)
+    {
+        HAL_LCD_writeDataBuffer(buffer, sizeof(buffer));
+        count -= PIXEL_CHUNK;
+    }
+    HAL_LCD_writeDataBuffer(buffer, count * 2);
+}
+
+static inline void Crystalfontz128x128_PixelDrawAt(int16_t lX, int16_t lY,
+                                                   uint16_t ulValue)
+{
+    uint8_t data[2];
+
+    data[0] = ulValue >> 8;
+    data[1] = ulValue;
+    Crystalfontz128x128_WriteFrame(lX, lY, lX, lY);
+    HAL_LCD_writeCommand(CM_RAMWR);
+    HAL_LCD_writeDataBuffer(data, 2);
+}
+
+static inline void Crystalfontz128x128_PixelDrawMultipleAt(int16_t lX, int16_t lY,
+                                                           int16_t lYMax,
+                                                           int16_t lX0,
+                                                           int16_t lCount,
+                                                           int16_t lBPP,
+                                                           const uint8_t *pucData,
+                                                           const uint32_t *pucPalette)
+{
+    // The frame runs to the last row, the same as the generic primitive
+    Crystalfontz128x128_WriteFrame(lX, lY, lX + lCount, lYMax);
+    HAL_LCD_writeCommand(CM_RAMWR);
 
+    // The format is picked once per run, not per pixel
+    switch(lBPP)
+    {
+        case 1:
+            Crystalfontz128x128_PixelRun1(lX0, lCount, pucData, pucPalette);
+            break;
+        case 4:
+            Crystalfontz128x128_PixelRun4(lX0 & 1, lCount, pucData, pucPalette);
+            break;
+        case 8:
+            Crystalfontz128x128_PixelRun8(0, lCount, pucData, pucPalette);
+            break;
+        case 16:
+            Crystalfontz128x128_PixelRun16(0, lCount, pucData, pucPalette);
+            break;
+    }
+}
+
+static inline void Crystalfontz128x128_RectFillAt(int16_t x0, int16_t y0,
+                                                  int16_t x1, int16_t y1,
+                                                  uint16_t ulValue)
+{
+    Crystalfontz128x128_WriteFrame(x0, y0, x1, y1);
+    HAL_LCD_writeCommand(CM_RAMWR);
+    Crystalfontz128x128_FillRun(ulValue, (int32_t)(x1 - x0 + 1) * (y1 - y0 + 1));
+}
+
+#define CRYSTALFONTZ_ORIENTATION(name, dx, dy)                                \
+static void Crystalfontz128x128_PixelDraw##name(const Graphics_Display *pDisplay, \
+                                                int16_t lX, int16_t lY,       \
+                                                uint16_t ulValue)             \
+{                                                                             \
+    Crystalfontz128x128_PixelDrawAt(lX + dx, lY + dy, ulValue);               \
+}                                                                             \
+static void Crystalfontz128x128_PixelDrawMultiple##name(const Graphics_Display *pDisplay, \
+                                                        int16_t lX, int16_t lY, \
+                                                        int16_t lX0,          \
+                                                        int16_t lCount,       \
+                                                        int16_t lBPP,         \
+                                                        const uint8_t *pucData, \
+                                                        const uint32_t *pucPalette) \
+{                                                                             \
+    Crystalfontz128x128_PixelDrawMultipleAt(lX + dx, lY + dy,                 \
+                                            LCD_VERTICAL_MAX - 1 + dy, lX0,   \
+                                            lCount, lBPP, pucData, pucPalette); \
+}                                                                             \
+static void Crystalfontz128x128_LineDrawH##name(const Graphics_Display *pDisplay, \
+                                                int16_t lX1, int16_t lX2,     \
+                                                int16_t lY, uint16_t ulValue) \
+{                                                                             \
+    Crystalfontz128x128_RectFillAt(lX1 + dx, lY + dy, lX2 + dx, lY + dy, ulValue); \
+}                                                                             \
+static void Crystalfontz128x128_LineDrawV##name(const Graphics_Display *pDisplay, \
+                                                int16_t lX, int16_t lY1,      \
+                                                int16_t lY2, uint16_t ulValue) \
+{                                                                             \
+    Crystalfontz128x128_RectFillAt(lX + dx, lY1 + dy, lX + dx, lY2 + dy, ulValue); \
+}                                                                             \
+static void Crystalfontz128x128_RectFill##name(const Graphics_Display *pDisplay, \
+                                               const Graphics_Rectangle *pRect, \
+                                               uint16_t ulValue)              \
+{                                                                             \
+    Crystalfontz128x128_RectFillAt(pRect->sXMin + dx, pRect->sYMin + dy,      \
+                                   pRect->sXMax + dx, pRect->sYMax + dy, ulValue); \
+}                                                                             \
+static void Crystalfontz128x128_ClearScreen##name(const Graphics_Display *pDisplay, \
+                                                  uint16_t ulValue)           \
+{                                                                             \
+    Crystalfontz128x128_RectFillAt(dx, dy, LCD_HORIZONTAL_MAX - 1 + dx,       \
+                                   LCD_VERTICAL_MAX - 1 + dy, ulValue);       \
+}                                                                             \
+static const Graphics_Display_Functions Crystalfontz128x128_funcs##name =     \
+{                                                                             \
+    Crystalfontz128x128_PixelDraw##name,                                      \
+    Crystalfontz128x128_PixelDrawMultiple##name,                              \
+    Crystalfontz128x128_LineDrawH##name,                                      \
+    Crystalfontz128x128_LineDrawV##name,                                      \
+    Crystalfontz128x128_RectFill##name,                                       \
+    Crystalfontz128x128_ColorTranslate,                                       \
+    Crystalfontz128x128_Flush,                                                \
+    Crystalfontz128x128_ClearScreen##name                                     \
+};
+
+CRYSTALFONTZ_ORIENTATION(Up, OFFSET_UP_X, OFFSET_UP_Y)
+CRYSTALFONTZ_ORIENTATION(Left, OFFSET_LEFT_X, OFFSET_LEFT_Y)
+CRYSTALFONTZ_ORIENTATION(Down, OFFSET_DOWN_X, OFFSET_DOWN_Y)
+CRYSTALFONTZ_ORIENTATION(Right, OFFSET_RIGHT_X, OFFSET_RIGHT_Y)
+
+// Indexed by LCD_ORIENTATION_UP, _LEFT, _DOWN and _RIGHT
+static const Graphics_Display_Functions *const Crystalfontz128x128_variants[4] =
+{
+    &Crystalfontz128x128_funcsUp,
+    &Crystalfontz128x128_funcsLeft,
+    &Crystalfontz128x128_funcsDown,
+    &Crystalfontz128x128_funcsRight
+};
+
+//*****************************************************************************
+//
+//! The primitives for the current orientation, filled in by
+//! Crystalfontz128x128_SetOrientation().
+//
+//*****************************************************************************
+Graphics_Display_Functions g_sCrystalfontz128x128_funcs =
+{
+    Crystalfontz128x128_PixelDrawUp,
+    Crystalfontz128x128_PixelDrawMultipleUp,
+    Crystalfontz128x128_LineDrawHUp,
+    Crystalfontz128x128_LineDrawVUp,
+    Crystalfontz128x128_RectFillUp,
+    Crystalfontz128x128_ColorTranslate,
+    Crystalfontz128x128_Flush,
+    Crystalfontz128x128_ClearScreenUp
 };
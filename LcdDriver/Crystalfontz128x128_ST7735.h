@@ -99,12 +99,26 @@ extern uint16_t Lcd_TouchTrim;
 
 extern Graphics_Display g_sCrystalfontz128x128;
 
-extern const Graphics_Display_Functions g_sCrystalfontz128x128_funcs;
+extern Graphics_Display_Functions g_sCrystalfontz128x128_funcs;
+
+extern const Graphics_Display_Functions g_sCrystalfontz128x128_genericFuncs;
 
 extern void Crystalfontz128x128_Init(void);
 
+extern void Crystalfontz128x128_InitStart(void);
+
+extern bool Crystalfontz128x128_InitStep(void);
+
+extern void Crystalfontz128x128_Fill(uint16_t color);
+
+extern void Crystalfontz128x128_DisplayOn(void);
+
 extern void Crystalfontz128x128_SetDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
 
+extern void Crystalfontz128x128_QueueDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+extern uint32_t Crystalfontz128x128_Blit(const Graphics_Display *canvas, uint16_t x, uint16_t y);
+
 extern void Crystalfontz128x128_SetOrientation(uint8_t orientation);
 
 
@@ -42,6 +42,54 @@
 #include <ti/devices/msp432p4xx/driverlib/driverlib.h>
 #include <stdint.h>
 
+// DMA control table, the uDMA needs it on a 1024 byte boundary
+#if defined(__TI_COMPILER_VERSION__)
+#pragma DATA_ALIGN(lcdDmaControlTable, 1024)
+DMA_ControlTable lcdDmaControlTable[32];
+#elif defined(__IAR_SYSTEMS_ICC__)
+#pragma data_alignment=1024
+DMA_ControlTable lcdDmaControlTable[32];
+#else
+DMA_ControlTable lcdDmaControlTable[32] __attribute__ ((aligned (1024)));
+#endif
+
+static uint32_t delayStart, delayCycles;
+
+//*****************************************************************************
+//
+// Display list. Records are written at listQueued and run at listDone, both
+// count up forever and index the ring modulo its size. A fence is the value
+// of listQueued when it was taken.
+//
+//*****************************************************************************
+#define LCD_LIST_COMMAND    0
+#define LCD_LIST_FILL       1
+#define LCD_LIST_BLIT       2
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t command;
+    uint8_t dataLength;
+    uint8_t data[4];
+    uint16_t color;
+    uint32_t length;            // pixels for a fill, bytes for a blit
+    const uint8_t *source;
+} LCD_ListRecord;
+
+static LCD_ListRecord listRing[LCD_LIST_SIZE];
+static volatile uint32_t listQueued, listDone;
+static volatile bool listActive;        // the engine owns the bus
+static bool listSending;                // the current record is being sent by DMA
+static uint32_t listLeft;               // bytes of it still to start
+static const uint8_t *listSource;
+static uint8_t listPattern[256];        // one row of the fill color
+
+uint32_t HAL_LCD_listMaxDepth;
+uint32_t HAL_LCD_listFullWaits;
+uint32_t HAL_LCD_listBytes;             // bytes the display list has put on the bus
+uint32_t HAL_LCD_spiClock;              // SPI bit clock actually in use (in Hz)
+
 void HAL_LCD_PortInit(void)
 {
     // LCD_SCK
@@ -61,7 +109,7 @@ void HAL_LCD_SpiInit(void)
     eUSCI_SPI_MasterConfig config =
         {
             EUSCI_B_SPI_CLOCKSOURCE_SMCLK,
-            LCD_SYSTEM_CLOCK_SPEED,
+            CS_getSMCLK(),
             LCD_SPI_CLOCK_SPEED,
             EUSCI_B_SPI_MSB_FIRST,
             EUSCI_B_SPI_PHASE_DATA_CAPTURED_ONFIRST_CHANGED_ON_NEXT,
@@ -71,9 +119,274 @@ void HAL_LCD_SpiInit(void)
     SPI_initMaster(LCD_EUSCI_BASE, &config);
     SPI_enableModule(LCD_EUSCI_BASE);
 
+    // The prescaler is the integer ratio, and 0 runs at SMCLK
+    if (config.clockSourceFrequency > LCD_SPI_CLOCK_SPEED)
+        HAL_LCD_spiClock = config.clockSourceFrequency /
+                           (config.clockSourceFrequency / LCD_SPI_CLOCK_SPEED);
+    else
+        HAL_LCD_spiClock = config.clockSourceFrequency;
+
     GPIO_setOutputLowOnPin(LCD_CS_PORT, LCD_CS_PIN);
 
     GPIO_setOutputHighOnPin(LCD_DC_PORT, LCD_DC_PIN);
+
+    HAL_LCD_DmaInit();
+}
+
+//*****************************************************************************
+//
+// Sets up the uDMA channel that feeds the SPI transmit buffer. Each byte is
+// requested by the eUSCI_B0 TX flag, so the DMA keeps pace with the bus.
+//
+//*****************************************************************************
+void HAL_LCD_DmaInit(void)
+{
+    DMA_enableModule();
+    DMA_setControlBase(lcdDmaControlTable);
+    DMA_assignChannel(LCD_DMA_CHANNEL_TX);
+    DMA_disableChannelAttribute(LCD_DMA_CHANNEL_TX,
+                                UDMA_ATTR_ALTSELECT | UDMA_ATTR_USEBURST |
+                                UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+    DMA_setChannelControl(UDMA_PRI_SELECT | LCD_DMA_CHANNEL_TX,
+                          UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_1);
+
+    // The end of each transfer moves the display list on
+    DMA_assignInterrupt(DMA_INT1, LCD_DMA_CHANNEL_NUM);
+    DMA_clearInterruptFlag(LCD_DMA_CHANNEL_NUM);
+    DMA_enableInterrupt(DMA_INT1);
+    Interrupt_enableInterrupt(DMA_INT1);
+}
+
+//*****************************************************************************
+//
+// Starts the DMA for the next piece of the current record.
+//
+//*****************************************************************************
+RAMFUNC static void listStartChunk(void)
+{
+    uint32_t chunk = listLeft;
+
+    if (listRing[listDone % LCD_LIST_SIZE].type == LCD_LIST_FILL)
+    {
+        if (chunk > sizeof(listPattern))
+            chunk = sizeof(listPattern);
+        DMA_setChannelTransfer(UDMA_PRI_SELECT | LCD_DMA_CHANNEL_TX, UDMA_MODE_BASIC,
+                               listPattern,
+                               (void *)SPI_getTransmitBufferAddressForDMA(LCD_EUSCI_BASE),
+                               chunk);
+    }
+    else
+    {
+        if (chunk > 1024)
+            chunk = 1024;
+        DMA_setChannelTransfer(UDMA_PRI_SELECT | LCD_DMA_CHANNEL_TX, UDMA_MODE_BASIC,
+                               (void *)listSource,
+                               (void *)SPI_getTransmitBufferAddressForDMA(LCD_EUSCI_BASE),
+                               chunk);
+        listSource += chunk;
+    }
+    listLeft -= chunk;
+    HAL_LCD_listBytes += chunk;
+
+    DMA_enableChannel(LCD_DMA_CHANNEL_NUM);
+    DMA_requestSoftwareTransfer(LCD_DMA_CHANNEL_NUM);
+}
+
+//*****************************************************************************
+//
+// Runs the display list until it is empty or a DMA transfer is under way.
+// Called from the DMA interrupt, or with it masked when the list was idle.
+//
+//*****************************************************************************
+RAMFUNC static void listRun(void)
+{
+    LCD_ListRecord *record;
+    int i;
+
+    listActive = true;
+    while (1)
+    {
+        if (listLeft > 0)
+        {
+            listStartChunk();
+            return;
+        }
+        if (listSending)
+        {
+            // The last piece of this record has gone to the SPI
+            listSending = false;
+            listDone++;
+        }
+        if (listDone == listQueued)
+            break;
+
+        record = &listRing[listDone % LCD_LIST_SIZE];
+        switch (record->type)
+        {
+        case LCD_LIST_COMMAND:
+            // USCI_B0 Busy? //
+            while (UCB0STATW & UCBUSY);
+            GPIO_setOutputLowOnPin(LCD_DC_PORT, LCD_DC_PIN);
+            UCB0TXBUF = record->command;
+            while (UCB0STATW & UCBUSY);
+            GPIO_setOutputHighOnPin(LCD_DC_PORT, LCD_DC_PIN);
+
+            for (i = 0; i < record->dataLength; i++)
+            {
+                while (!(UCB0IFG & UCTXIFG));
+                UCB0TXBUF = record->data[i];
+            }
+            HAL_LCD_listBytes += 1 + record->dataLength;
+            listDone++;
+            break;
+
+        case LCD_LIST_FILL:
+            for (i = 0; i < (int)sizeof(listPattern); i += 2)
+            {
+                listPattern[i] = record->color >> 8;
+                listPattern[i + 1] = record->color;
+            }
+            listLeft = record->length * 2;
+            listSending = true;
+            break;
+
+        default:
+            listSource = record->source;
+            listLeft = record->length;
+            listSending = true;
+            break;
+        }
+    }
+
+    // USCI_B0 Busy? //
+    while (UCB0STATW & UCBUSY);
+    listActive = false;
+}
+
+RAMFUNC void DMA_INT1_IRQHandler(void)
+{
+    DMA_clearInterruptFlag(LCD_DMA_CHANNEL_NUM);
+    listRun();
+}
+
+//*****************************************************************************
+//
+// Claims the next free record, waiting for the engine when the ring is full.
+//
+//*****************************************************************************
+static LCD_ListRecord *listNext(void)
+{
+    if (listQueued - listDone >= LCD_LIST_SIZE)
+    {
+        HAL_LCD_listFullWaits++;
+        while (listQueued - listDone >= LCD_LIST_SIZE);
+    }
+    return &listRing[listQueued % LCD_LIST_SIZE];
+}
+
+//*****************************************************************************
+//
+// Hands the record from listNext() to the engine, starting it if it is idle.
+//
+//*****************************************************************************
+static void listCommit(void)
+{
+    uint32_t depth;
+
+    Interrupt_disableInterrupt(DMA_INT1);
+    listQueued++;
+    depth = listQueued - listDone;
+    if (depth > HAL_LCD_listMaxDepth)
+        HAL_LCD_listMaxDepth = depth;
+    if (!listActive)
+        listRun();
+    Interrupt_enableInterrupt(DMA_INT1);
+}
+
+//*****************************************************************************
+//
+// Queues a command byte followed by up to four data bytes.
+//
+//*****************************************************************************
+void HAL_LCD_queueCommand(uint8_t command, const uint8_t *data, uint8_t length)
+{
+    LCD_ListRecord *record = listNext();
+    int i;
+
+    record->type = LCD_LIST_COMMAND;
+    record->command = command;
+    record->dataLength = length;
+    for (i = 0; i < length; i++)
+        record->data[i] = data[i];
+    listCommit();
+}
+
+//*****************************************************************************
+//
+// Queues count pixels of one color, high byte first, into the open window.
+//
+//*****************************************************************************
+void HAL_LCD_queueFill(uint16_t color, uint32_t count)
+{
+    LCD_ListRecord *record = listNext();
+
+    record->type = LCD_LIST_FILL;
+    record->color = color;
+    record->length = count;
+    listCommit();
+}
+
+//*****************************************************************************
+//
+// Queues a block of data for the open window. The data is read when the
+// record runs, so it must stay put until a fence taken after this call is
+// done.
+//
+//*****************************************************************************
+void HAL_LCD_queueBlit(const uint8_t *data, uint32_t length)
+{
+    LCD_ListRecord *record = listNext();
+
+    record->type = LCD_LIST_BLIT;
+    record->source = data;
+    record->length = length;
+    listCommit();
+}
+
+//*****************************************************************************
+//
+// Returns a fence for everything queued so far.
+//
+//*****************************************************************************
+uint32_t HAL_LCD_queueFence(void)
+{
+    return listQueued;
+}
+
+bool HAL_LCD_fenceDone(uint32_t fence)
+{
+    return (int32_t)(listDone - fence) >= 0;
+}
+
+void HAL_LCD_waitFence(uint32_t fence)
+{
+    while (!HAL_LCD_fenceDone(fence));
+}
+
+uint32_t HAL_LCD_queueDepth(void)
+{
+    return listQueued - listDone;
+}
+
+//*****************************************************************************
+//
+// Waits until the display list is empty and the bus is free. Everything
+// that drives the SPI directly calls this first.
+//
+//*****************************************************************************
+void HAL_LCD_waitQueue(void)
+{
+    while (listDone != listQueued || listActive);
 }
 
 
@@ -85,6 +398,8 @@ void HAL_LCD_SpiInit(void)
 //*****************************************************************************
 void HAL_LCD_writeCommand(uint8_t command)
 {
+    HAL_LCD_waitQueue();
+
     // Set to command mode
     GPIO_setOutputLowOnPin(LCD_DC_PORT, LCD_DC_PIN);
 
@@ -110,6 +425,8 @@ void HAL_LCD_writeCommand(uint8_t command)
 //*****************************************************************************
 void HAL_LCD_writeData(uint8_t data)
 {
+    HAL_LCD_waitQueue();
+
     // USCI_B0 Busy? //
     while (UCB0STATW & UCBUSY);
 
@@ -120,6 +437,87 @@ void HAL_LCD_writeData(uint8_t data)
     while (UCB0STATW & UCBUSY);
 }
 
+//*****************************************************************************
+//
+// Writes a block of data to the CFAF128128B-0145T.  Unlike HAL_LCD_writeData,
+// the next byte is loaded as soon as the transmit buffer is free, so the bus
+// is only waited on once at the end of the block. Runs from SRAM, with a
+// flash copy for timing.
+//
+//*****************************************************************************
+RAMFUNC_TWIN(void, HAL_LCD_writeDataBuffer, (const uint8_t *data, uint16_t length),
+    HAL_LCD_waitQueue();
+
+    while (length--)
+    {
+        // USCI_B0 TX buffer ready? //
+        while (!(UCB0IFG & UCTXIFG));
+
+        // Transmit data
+        UCB0TXBUF = *data++;
+    }
+
+    // USCI_B0 Busy? //
+    while (UCB0STATW & UCBUSY);
+)
+
+//*****************************************************************************
+//
+// Starts sending a block of up to 1024 bytes of data by DMA and returns right
+// away. The bus must be idle and in data mode. HAL_LCD_waitDMA() waits for
+// the last byte.
+//
+//*****************************************************************************
+void HAL_LCD_writeDataDMA(const uint8_t *data, uint16_t length)
+{
+    HAL_LCD_waitQueue();
+
+    DMA_setChannelTransfer(UDMA_PRI_SELECT | LCD_DMA_CHANNEL_TX, UDMA_MODE_BASIC,
+                           (void *)data,
+                           (void *)SPI_getTransmitBufferAddressForDMA(LCD_EUSCI_BASE),
+                           length);
+    DMA_enableChannel(LCD_DMA_CHANNEL_NUM);
+
+    // TXIFG is already set on an idle bus, so the first byte is requested by
+    // software. The rest follow the TX flag.
+    DMA_requestSoftwareTransfer(LCD_DMA_CHANNEL_NUM);
+}
+
+//*****************************************************************************
+//
+// Waits until a block started by HAL_LCD_writeDataDMA has been shifted out.
+//
+//*****************************************************************************
+void HAL_LCD_waitDMA(void)
+{
+    while (DMA_isChannelEnabled(LCD_DMA_CHANNEL_NUM));
+
+    // USCI_B0 Busy? //
+    while (UCB0STATW & UCBUSY);
+}
+
+//*****************************************************************************
+//
+// Starts a delay of at least the given number of microseconds. It is timed
+// by the DWT cycle counter at the current MCLK, so it is right at any clock
+// setting, unlike HAL_LCD_delay. HAL_LCD_delayDone() tells when it is over,
+// and the CPU is free to do other work until then.
+//
+//*****************************************************************************
+void HAL_LCD_startDelay(uint32_t us)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    delayStart = DWT->CYCCNT;
+    delayCycles = us * (CS_getMCLK() / 1000000);
+}
+
+bool HAL_LCD_delayDone(void)
+{
+    return (DWT->CYCCNT - delayStart) >= delayCycles;
+}
+
 //*****************************************************************************
 //
 //! Provides a small delay.
@@ -49,9 +49,10 @@
 //
 //*****************************************************************************
 
-// System clock speed (in Hz)
+// System clock speed (in Hz), only used by HAL_LCD_delay. The SPI clock is
+// worked out from the actual SMCLK.
 #define LCD_SYSTEM_CLOCK_SPEED                 48000000
-// SPI clock speed (in Hz)
+// SPI clock speed (in Hz), or as close as SMCLK allows
 #define LCD_SPI_CLOCK_SPEED                    16000000
 
 // Ports from MSP432 connected to LCD
@@ -73,6 +74,28 @@
 // Definition of USCI base address to be used for SPI communication
 #define LCD_EUSCI_BASE        EUSCI_B0_BASE
 
+// DMA channel triggered by the SPI transmit buffer
+#define LCD_DMA_CHANNEL_TX    DMA_CH0_EUSCIB0TX0
+#define LCD_DMA_CHANNEL_NUM   0
+
+// Records in the display list, a power of two
+#define LCD_LIST_SIZE         32
+
+// Functions marked RAMFUNC run from SRAM. The .TI.ramfunc section is stored
+// in MAIN and copied to SRAM_CODE at boot (see msp432p401r.cmd), so they do
+// not wait on the flash. Other compilers leave them in flash.
+#if defined(__TI_COMPILER_VERSION__) && (__TI_COMPILER_VERSION__ >= 15009000)
+#define RAMFUNC               __attribute__((ramfunc))
+#else
+#define RAMFUNC
+#endif
+
+// Defines a RAMFUNC function and a flash copy of it called name##Flash, so
+// the two can be timed against each other.
+#define RAMFUNC_TWIN(type, name, params, ...) \
+    RAMFUNC type name params { __VA_ARGS__ } \
+    type name##Flash params { __VA_ARGS__ }
+
 //*****************************************************************************
 //
 // Prototypes for the globals exported by this driver.
@@ -80,8 +103,27 @@
 //*****************************************************************************
 extern void HAL_LCD_writeCommand(uint8_t command);
 extern void HAL_LCD_writeData(uint8_t data);
+extern void HAL_LCD_writeDataBuffer(const uint8_t *data, uint16_t length);
+extern void HAL_LCD_writeDataBufferFlash(const uint8_t *data, uint16_t length);
+extern void HAL_LCD_writeDataDMA(const uint8_t *data, uint16_t length);
+extern void HAL_LCD_waitDMA(void);
 extern void HAL_LCD_PortInit(void);
 extern void HAL_LCD_SpiInit(void);
+extern void HAL_LCD_DmaInit(void);
+extern void HAL_LCD_startDelay(uint32_t us);
+extern bool HAL_LCD_delayDone(void);
+extern void HAL_LCD_queueCommand(uint8_t command, const uint8_t *data, uint8_t length);
+extern void HAL_LCD_queueFill(uint16_t color, uint32_t count);
+extern void HAL_LCD_queueBlit(const uint8_t *data, uint32_t length);
+extern uint32_t HAL_LCD_queueFence(void);
+extern bool HAL_LCD_fenceDone(uint32_t fence);
+extern void HAL_LCD_waitFence(uint32_t fence);
+extern uint32_t HAL_LCD_queueDepth(void);
+extern void HAL_LCD_waitQueue(void);
+extern uint32_t HAL_LCD_listMaxDepth;
+extern uint32_t HAL_LCD_listFullWaits;
+extern uint32_t HAL_LCD_listBytes;
+extern uint32_t HAL_LCD_spiClock;
 
 // Custom __delay_cycles() for non CCS Compiler
 #if !defined( __TI_ARM__ )
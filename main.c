@@ -1,30 +1,97 @@
 #include <ti/devices/msp432p4xx/driverlib/driverlib.h>
 #include <ti/grlib/grlib.h>
+#include <string.h>
 #include "LcdDriver/Crystalfontz128x128_ST7735.h"
 #include "LcdDriver/HAL_MSP_EXP432P401R_Crystalfontz128x128_ST7735.h"
+#include "LcdDriver/Canvas_RGB565.h"
 
 // Global parameters with current application settings
 
-typedef enum {black, red, green, yellow, blue, magenta, cyan, white} color_t; //enums for color, baud rate, and FSMs
+typedef enum {black, red, green, yellow, blue, magenta, cyan, white, custom} color_t; //enums for color, baud rate, and FSMs
 typedef enum {baud9600, baud19200, baud38400, baud57600} UARTBaudRate_t;
 typedef enum {stable0, trans0to1, stable1, trans1to0} state_t;
-typedef enum {idle, command, commandB, commandF} parseState_t;
+typedef enum {idle, opcode, argument, escape, csi, imageHead, imageData, qoiHead, qoiData, framed} parseState_t;
+typedef enum {argNone, argDigit, argDec, argHex6} argType_t;
+typedef enum {termCmtt16, termFixed6x8} termMode_t;
 
 #define ASCII2INT -48 //initializing constants
 #define INT2ASCII 48
 #define STARTROW 2
 #define STATUSROW1 0
 #define STATUSROW2 1
+#define FIXED_CELL_WIDTH 6 //cell size of the uncompressed g_sFontFixed6x8 glyphs
+#define FIXED_CELL_HEIGHT 8
+#define MAXCOLS 21 //widest grid, used to size the run buffers
+#define COUNTERCOL 2 //first digit of charCounter on STATUSROW2
+#define MAXCOUNTERDIGITS 10 //enough for a 32 bit counter
+#define MAXROWS 16 //tallest grid
+#define SCROLLBACK_LINES 256 //lines of history kept in SRAM
+#define FRAMERATE 60 //text frames per second until #r<n>; changes it
+#define MAXFRAMERATE 100
+#ifndef SETTINGS_STORE
+#define SETTINGS_STORE 1 //0 leaves INFO flash alone, every boot starts from the defaults
+#endif
+
+//24 bit RGB to RGB565, with the two bytes swapped so the high byte comes
+//first in memory and a pixel buffer can be sent to the panel as it is
+#define RGB565_SWAPPED(rgb) ((uint16_t)((((rgb) >> 16) & 0xF8) | (((rgb) >> 13) & 0x07) | \
+                                        ((((rgb) >> 10) & 0x07) << 13) | ((((rgb) >> 3) & 0x1F) << 8)))
+#define SWAP16(v) ((uint16_t)(((v) << 8) | ((v) >> 8)))
+
+uint32_t charCounter = 0;//characters received on every port
+bool uartEcho = true;//text is echoed back, except in framed mode
+uint32_t frameRate = FRAMERATE;//0 draws text as soon as it is parsed
+
+UARTBaudRate_t baudRate = 0;//initalization of baud rate
+color_t color;
 
-int rowNum = 0; //list of global variables to keep track of cursor positions and character counter
-int colNum = 0;
-int charCounter = 0;
+const uint16_t colorTable[8] = {//pixel value for each color_t, same order as the enum
+    RGB565_SWAPPED(GRAPHICS_COLOR_BLACK),
+    RGB565_SWAPPED(GRAPHICS_COLOR_RED),
+    RGB565_SWAPPED(GRAPHICS_COLOR_GREEN),
+    RGB565_SWAPPED(GRAPHICS_COLOR_YELLOW),
+    RGB565_SWAPPED(GRAPHICS_COLOR_BLUE),
+    RGB565_SWAPPED(GRAPHICS_COLOR_MAGENTA),
+    RGB565_SWAPPED(GRAPHICS_COLOR_CYAN),
+    RGB565_SWAPPED(GRAPHICS_COLOR_WHITE)
+};
 
-UARTBaudRate_t baudRate = 0;//initalization of baud rate and fg/bg colors
-color_t fg = 7, bg = 4;
-color_t color;
-static parseState_t presentState = idle;
-uint8_t previousChar = ' ';
+//Everything one stream of text needs: a pane of the text rows, a cursor,
+//colors and the parser state. Each UART has its own, the console (EUSCI_A0)
+//is terms[CONSOLE], and term is the one being parsed or drawn for.
+#define NUMPORTS 4 //EUSCI_A0 to EUSCI_A3
+#define CONSOLE 0
+#define MAXCOMMANDLEN 16 //'#', opcode and argument
+#define MAXANSIPARAMS 4
+
+typedef struct {
+    uint32_t port;//EUSCI_A base address it is fed from
+    int top, rows;//screen rows of its pane
+    int rowNum, colNum;//cursor position
+    color_t fg, bg;
+    color_t defaultFg, defaultBg;//what SGR 0, 39 and 49 go back to
+    uint16_t fgPixel, bgPixel;//what the cell renderer draws with
+    uint16_t customFgPixel, customBgPixel;//last #fc/#bc colors, used whenever fg/bg is custom
+    parseState_t presentState;
+    uint8_t commandText[MAXCOMMANDLEN];//everything since the '#', printed if it does not match
+    int commandLen;
+    int firstMatch, lastMatch;//range of commandTable entries that match the opcode so far
+    int opcodeLen;
+    const struct command *matched;//entry whose opcode is exactly what was typed, if any
+    uint32_t argValue;
+    int argDigits;
+    uint16_t ansiParams[MAXANSIPARAMS];
+    int ansiCount;//number of parameters started so far
+    int savedRow, savedCol;//ESC[s and ESC 7
+} term_t;
+
+term_t terms[NUMPORTS];
+term_t *term = &terms[CONSOLE];
+int paneCount = 1;//terminals on screen, the console and paneCount - 1 more UARTs
+
+termMode_t termMode = termCmtt16;//active terminal geometry, changed with #m<d>
+int termCols = 16, termRows = 8;
+int cellWidth = 8, cellHeight = 16;
 
 //-----------------------------------------------------------------------
 // Character Graphics API
@@ -32,6 +99,19 @@ uint8_t previousChar = ' ';
 // The 128*128 pixel screen is partitioned in a grid of 8 rows of 16 characters
 // Each character is a plotted in a rectangle of 8 pixels (wide) by 16 pixels (high)
 //
+// In the dense terminal mode (#m1) the grid is 16 rows of 21 characters of
+// 6 by 8 pixels, using the uncompressed g_sFontFixed6x8 font. Those glyphs are
+// expanded here and written to the panel directly, without going through GRLIB.
+//
+// Text is not drawn as it is parsed. write2LCD only updates screenChars and
+// marks the cells dirty, and the render task draws a frame frameRate times a
+// second, or as soon as the input stops: each row with dirty cells goes out
+// as one window from its first to its last dirty cell, in the colors each
+// cell was written in. A burst of text costs one window per row per frame
+// instead of one per character. The render task draws a frame a slice at a
+// time and goes on from the next row in its next run, so a full screen of
+// text doesn't keep the UART waiting.
+//
 // The lower-level graphics functions are taken from the Texas Instruments Graphics Library
 //
 //            C Application        (this file)
@@ -44,29 +124,296 @@ uint8_t previousChar = ' ';
 
 Graphics_Context g_sContext;
 
-void InitGraphics() { //initalizing graphics, part of code given
-    Crystalfontz128x128_Init();
+void LCDSetFgColor();
+void LCDSetBgColor();
+void LCDSetTermMode(termMode_t mode);
+void LCDClearText();
+void PaneLayout();
+void TermSelect(int i);
+uint32_t CycleCount();
+void parseCommands(const uint8_t *buf, int len);
+
+void InitGraphics() { //initalizing graphics, part of code given, the panel is already powered up
     Crystalfontz128x128_SetOrientation(LCD_ORIENTATION_UP);
     Graphics_initContext(&g_sContext,
                          &g_sCrystalfontz128x128,
                          &g_sCrystalfontz128x128_funcs);
-    Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_WHITE);
-    Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_BLUE);
-    GrContextFontSet(&g_sContext, &g_sFontCmtt16);
-    Graphics_clearDisplay(&g_sContext);
+    LCDSetFgColor();//colors and mode may have come from the settings store
+    LCDSetBgColor();
+    LCDSetTermMode(termMode);//font, grid, and the first fill in the real background
+    Crystalfontz128x128_DisplayOn();
+}
+
+//what the text rows hold, one character and one attribute (fg | bg << 4) per
+//cell, so the screen can be put back after looking at the scrollback
+char screenChars[MAXROWS][MAXCOLS];
+uint8_t screenAttrs[MAXROWS][MAXCOLS];
+const char blankRow[MAXCOLS] = "                     ";
+int historyView = 0;//lines scrolled back through the scrollback, 0 is the live screen
+int rowView[MAXROWS];//view each console row shows on the panel, -1 if it is a mix
+bool historyPending = false;//some rows have not caught up with historyView yet
+int historyCol = 0;//how far the first row that hasn't caught up has got
+
+void historyLive() {//the console rows were just cleared, so they show the live screen
+    int row;
+
+    historyView = 0;
+    for (row = 0; row < MAXROWS; row++)
+        rowView[row] = 0;
+    historyPending = false;
+    historyCol = 0;
+}
+bool imageWindowSet = false;//an image upload owns the panel window, cleared by anything else that draws
+
+//text only goes into screenChars and marks its cells dirty, LCDRenderFrame
+//draws them a frame at a time, one window write per row
+static int8_t dirtyFirst[MAXROWS], dirtyLast[MAXROWS];//cells changed since the last frame, first > last if none
+static bool screenDirty = false;//some row has dirty cells
+
+uint8_t currentAttr() {
+    return term->fg | (term->bg << 4);
+}
+
+void clearScreenRows(int first, int count) {//blank count rows of the screen buffer
+    int row, col;
+    for (row = first; row < first + count && row < MAXROWS; row++)
+    {
+        for (col = 0; col < MAXCOLS; col++)
+        {
+            screenChars[row][col] = ' ';
+            screenAttrs[row][col] = currentAttr();
+        }
+        dirtyFirst[row] = MAXCOLS;//the panel is cleared along with it
+        dirtyLast[row] = -1;
+    }
+}
+
+void markDirty(int row, int first, int last) {//cells first..last of row go out with the next frame
+    if (first < dirtyFirst[row])
+        dirtyFirst[row] = first;
+    if (last > dirtyLast[row])
+        dirtyLast[row] = last;
+    screenDirty = true;
 }
 
 void LCDClearDisplay() {//clear the LCD display
-    Graphics_clearDisplay(&g_sContext);
+    clearScreenRows(0, MAXROWS);
+    historyLive();
+    imageWindowSet = false;
+    Crystalfontz128x128_QueueDrawFrame(0, 0, LCD_HORIZONTAL_MAX - 1, LCD_VERTICAL_MAX - 1);//same as Graphics_clearDisplay, but sent in the background
+    HAL_LCD_queueFill(SWAP16(term->bgPixel), LCD_HORIZONTAL_MAX * LCD_VERTICAL_MAX);
+}
+
+//pixel rows of a run are expanded into one buffer while the DMA sends the other
+static uint16_t runRows[2][MAXCOLS * FIXED_CELL_WIDTH];//RGB565 high byte first
+static uint32_t runFence[2] = {0, 0};//display list fence for the row last sent from each buffer
+
+//cmtt16 runs are drawn by GRLIB into a canvas, then sent as one window write
+static uint16_t runCanvasPixels[LCD_HORIZONTAL_MAX * 16];//one cmtt16 text row
+static Graphics_Display runCanvas;
+static Graphics_Context runContext;
+static uint32_t runCanvasFence = 0;
+
+//expands pixel row r of len glyphs into RGB565, each in its own colors, runs from SRAM
+RAMFUNC_TWIN(void, expandGlyphRow, (uint16_t *out, const uint8_t *const *glyphs, const uint16_t *fgs, const uint16_t *bgs, int len, int r),
+    int i, px, bit;
+    for (i = 0; i < len; i++)
+    {
+        uint16_t fgPixel = fgs[i], bgPixel = bgs[i];
+        for (px = 0, bit = r * FIXED_CELL_WIDTH; px < FIXED_CELL_WIDTH; px++, bit++)
+            *out++ = (glyphs[i][bit >> 3] & (0x80 >> (bit & 7))) ? fgPixel : bgPixel;
+    }
+)
+
+//draws len characters on one row as a single window write, character i in
+//fgs[i] on bgs[i]
+void LCDDrawCells(unsigned row, unsigned col, const char *str, const uint16_t *fgs, const uint16_t *bgs, int len) {
+    int i, j;
+
+    row %= termRows;
+    col %= termCols;
+    if (len > termCols - (int)col)//runs never wrap, clip at the end of the row
+        len = termCols - col;
+    if (len <= 0)
+        return;
+
+    imageWindowSet = false;
+
+    if (termMode != termFixed6x8)//the compressed cmtt16 glyphs still go through GRLIB, off-screen
+    {
+        HAL_LCD_waitFence(runCanvasFence);//the last run may still be going out
+        Canvas_RGB565_init(&runCanvas, runCanvasPixels, len * cellWidth, cellHeight);
+        Graphics_initContext(&runContext, &runCanvas, &g_sCanvasRGB565_funcs);
+        GrContextFontSet(&runContext, &g_sFontCmtt16);
+        for (i = 0; i < len; i = j)//one string per stretch of cells in the same colors
+        {
+            for (j = i + 1; j < len && fgs[j] == fgs[i] && bgs[j] == bgs[i]; j++) ;
+            Graphics_Rectangle cells = {i * cellWidth, 0, j * cellWidth - 1, cellHeight - 1};
+            Graphics_setForegroundColorTranslated(&runContext, SWAP16(bgs[i]));
+            Graphics_fillRectangle(&runContext, &cells);//glyphs may not cover the whole cell
+            Graphics_setForegroundColorTranslated(&runContext, SWAP16(fgs[i]));
+            Graphics_setBackgroundColorTranslated(&runContext, SWAP16(bgs[i]));
+            Graphics_drawString(&runContext, (int8_t *)str + i, j - i, i * cellWidth, 0, OPAQUE_TEXT);
+        }
+        runCanvasFence = Crystalfontz128x128_Blit(&runCanvas, cellWidth * col, cellHeight * row);
+        return;
+    }
+
+    uint16_t x = FIXED_CELL_WIDTH * col;
+    uint16_t y = FIXED_CELL_HEIGHT * row;
+    const uint8_t *glyphs[MAXCOLS];
+    int r;
+
+    //uncompressed glyphs are a size byte, a width byte, then 6 bits per row
+    //packed MSB first
+    for (i = 0; i < len; i++)
+    {
+        char c = str[i];
+        if (c < ' ' || c > '~')//no glyph in the font, draw a blank cell
+            c = ' ';
+        glyphs[i] = g_sFontFixed6x8.data + g_sFontFixed6x8.offset[c - ' '] + 2;
+    }
+
+    Crystalfontz128x128_QueueDrawFrame(x, y, x + len * FIXED_CELL_WIDTH - 1, y + FIXED_CELL_HEIGHT - 1);
+    for (r = 0; r < FIXED_CELL_HEIGHT; r++)//one pixel row across every glyph of the run at a time
+    {
+        HAL_LCD_waitFence(runFence[r & 1]);//the DMA may still be reading this buffer
+        expandGlyphRow(runRows[r & 1], glyphs, fgs, bgs, len, r);
+        HAL_LCD_queueBlit((const uint8_t *)runRows[r & 1], len * FIXED_CELL_WIDTH * 2);
+        runFence[r & 1] = HAL_LCD_queueFence();
+    }
+}
+
+//draws len characters on one row in the current colors, as a single window write
+void LCDDrawRun(unsigned row, unsigned col, const char *str, int len) {
+    uint16_t fgs[MAXCOLS], bgs[MAXCOLS];
+    int i;
+
+    if (len > MAXCOLS)
+        len = MAXCOLS;
+    for (i = 0; i < len; i++)
+    {
+        fgs[i] = term->fgPixel;
+        bgs[i] = term->bgPixel;
+    }
+    LCDDrawCells(row, col, str, fgs, bgs, len);
 }
 
 void LCDDrawChar(unsigned row, unsigned col, int8_t c) {//writing to the LCD
-    Graphics_drawString(&g_sContext,
-                        &c,
-                        1,
-                        8 * (col % 16),
-                        16 * (row % 8),
-                        OPAQUE_TEXT);
+    LCDDrawRun(row, col, (const char *)&c, 1);
+}
+
+const term_t *rowTerm(int row) {//the terminal whose pane a text row is in
+    int i;
+
+    for (i = 1; i < paneCount; i++)
+        if (row >= terms[i].top && row < terms[i].top + terms[i].rows)
+            return &terms[i];
+    return &terms[CONSOLE];
+}
+
+int historyHalfRow() {//the first console row that hasn't caught up with historyView
+    int row;
+
+    for (row = 0; rowView[row] == historyView; row++) ;
+    return row;
+}
+
+uint32_t frameAt = 0;//when the last frame was drawn
+uint32_t lastRxAt = 0;//when input last came in, the next frame goes out early once it stops
+uint32_t frameCount = 0, frameGlyphs = 0, frameMaxGlyphs = 0;//since the last #p
+int renderRow = 0;//row a frame that ran out of its budget goes on from, 0 if none is under way
+static uint32_t renderGlyphs;//drawn so far in the frame under way
+
+bool LCDRenderStep(uint32_t budget) {//draw dirty rows, one window write each, false if budget ran out before the last
+    uint16_t fgs[MAXCOLS], bgs[MAXCOLS];
+    const term_t *t;
+    int row, col;
+    uint32_t begin = CycleCount();
+    color_t fg, bg;
+
+    if (renderRow == 0)//a new frame
+    {
+        frameAt = begin;
+        if (!screenDirty)
+            return true;
+        screenDirty = false;//text parsed from here on marks it again
+        renderGlyphs = 0;
+    }
+    for (row = renderRow; row < termRows; row++)
+    {
+        if (dirtyFirst[row] > dirtyLast[row])
+            continue;
+        t = rowTerm(row);
+        if (t == &terms[CONSOLE] && historyPending && historyCol > 0 && row - t->top == historyHalfRow())
+        {
+            rowView[row - t->top] = -1;//the half drawn row, LCDHistoryStep starts it over
+            historyCol = 0;
+        }
+        if (t != &terms[CONSOLE] || rowView[row - t->top] == 0)//else the panel shows a view LCDHistoryStep diffs against
+        {
+            for (col = dirtyFirst[row]; col <= dirtyLast[row]; col++)//colors come from the attributes, not the current ones
+            {
+                fg = (color_t)(screenAttrs[row][col] & 0xF);
+                bg = (color_t)(screenAttrs[row][col] >> 4);
+                fgs[col] = (fg == custom) ? t->customFgPixel : colorTable[fg];
+                bgs[col] = (bg == custom) ? t->customBgPixel : colorTable[bg];
+            }
+            col = dirtyFirst[row];
+            LCDDrawCells(row, col, screenChars[row] + col, fgs + col, bgs + col, dirtyLast[row] - col + 1);
+            renderGlyphs += dirtyLast[row] - col + 1;
+        }
+        dirtyFirst[row] = MAXCOLS;
+        dirtyLast[row] = -1;
+        if (row + 1 < termRows && CycleCount() - begin >= budget)//yield between rows, the rest is drawn next time
+        {
+            renderRow = row + 1;
+            return false;
+        }
+    }
+    renderRow = 0;
+
+    frameCount++;
+    frameGlyphs += renderGlyphs;
+    if (renderGlyphs > frameMaxGlyphs)
+        frameMaxGlyphs = renderGlyphs;
+    return true;
+}
+
+void LCDRenderFrame() {//draw everything that is dirty now
+    LCDRenderStep(0xFFFFFFFF);//the rest of a frame under way
+    if (screenDirty)//and the rows it had already passed
+        LCDRenderStep(0xFFFFFFFF);
+}
+
+void LCDSetTermMode(termMode_t mode) {//switch the character grid and start over on a clean screen
+    int i;
+
+    termMode = mode;
+    if (mode == termFixed6x8)//21x16 grid of 6x8 cells
+    {
+        termCols = 21;
+        termRows = 16;
+        cellWidth = FIXED_CELL_WIDTH;
+        cellHeight = FIXED_CELL_HEIGHT;
+        GrContextFontSet(&g_sContext, &g_sFontFixed6x8);
+    }
+    else//16x8 grid of 8x16 cells
+    {
+        termCols = 16;
+        termRows = 8;
+        cellWidth = 8;
+        cellHeight = 16;
+        GrContextFontSet(&g_sContext, &g_sFontCmtt16);
+    }
+    PaneLayout();
+    LCDClearDisplay();//in the console background
+    for (i = 1; i < paneCount; i++)//the other panes in their own
+    {
+        TermSelect(i);
+        LCDClearText();
+    }
+    TermSelect(CONSOLE);
 }
 
 //------------------------------------------
@@ -97,27 +444,171 @@ eUSCI_UART_Config uartConfig = {
      EUSCI_A_UART_NO_PARITY,                       // No Parity
      EUSCI_A_UART_LSB_FIRST,                       // LSB First
      EUSCI_A_UART_ONE_STOP_BIT,                    // One stop bit
-     EUSCI_A_UART_MODE,                            // UART mode
+     EUSCI_A_UART_AUTOMATIC_BAUDRATE_DETECTION_MODE, // UART mode, with auto baud
      EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION // Oversampling
 };
 
+//Received bytes are moved into rxRing by the RX interrupt, so nothing is lost
+//while the main loop is busy drawing. At 57600 baud the ring holds ~90ms.
+#define RXRINGSIZE 512
+static volatile uint8_t rxRing[RXRINGSIZE];
+static volatile uint16_t rxHead = 0, rxTail = 0;//written by the interrupt and the main loop
+volatile uint32_t rxOverflows = 0;//bytes dropped because the ring was full
+
+//Receive errors, counted by the interrupt and printed by #e. Characters
+//with a framing or parity error are dropped. An overrun means the byte
+//before this one was lost, so this one is kept. A break marks its place in
+//the ring, and the parser starts over once everything before it is read.
+volatile uint32_t rxOverruns = 0, rxFramingErrors = 0, rxParityErrors = 0, rxBreaks = 0;
+static volatile int16_t rxBreakAt = -1;//ring position of the last break, -1 for none
+
+//Transmitter of the loopback benchmark, which sends benchTotal bytes of
+//benchPattern from the TX interrupt and stamps each one with the cycle count
+#define BENCHSTAMPS (RXRINGSIZE * 2) //more than can be in flight without a drop: ring, batch and shift registers
+static const uint8_t *benchPattern;
+static int benchPatternLen;
+static volatile uint32_t benchSent = 0, benchTotal = 0;
+static uint32_t benchSentAt[BENCHSTAMPS];
+
+void benchTransmit() {
+    if (benchSent < benchTotal)
+    {
+        benchSentAt[benchSent % BENCHSTAMPS] = CycleCount();
+        UART_transmitData(EUSCI_A0_BASE, benchPattern[benchSent % benchPatternLen]);
+        benchSent++;
+    }
+    else
+        UART_disableInterrupt(EUSCI_A0_BASE, EUSCI_A_UART_TRANSMIT_INTERRUPT);
+}
+
+//Auto baud: the eUSCI runs in its automatic baud rate detection mode, so
+//after every break it measures the character that follows and loads the
+//raw divider it found, without the second modulation stage. If that
+//character is the sync 0x55, the interrupt snaps the measurement to the
+//closest supported rate and loads that rate's table divider. Anything else
+//was not meant as a sync field, and the table divider of the current rate
+//goes back in. Either way the port never runs on the raw measurement.
+//Neither the break nor the sync goes into the ring. UARTAutoBaud then takes
+//the new rate over and announces it.
+//A break on its own only resyncs the parser, and a 'U' after it is data.
+//0x55 is only taken as a sync field while auto baud is armed: from reset
+//until the first clean character, after a framing error (the host is
+//likely on another rate), and after #a. A host that changes rate on
+//purpose sends #a first.
+static volatile bool autoBaudArmed = true;
+static volatile bool autoBaudSync = false;//break seen, the sync field is next
+static volatile bool autoBaudDone = false;//sync measured, autoBaudRate not taken over yet
+static volatile UARTBaudRate_t autoBaudRate;
+bool baudAuto = false;//baudRate came from auto baud, shown on the status line
+
+UARTBaudRate_t UARTMeasuredBaud();
+void UARTLoadBaud(UARTBaudRate_t rate);
+
+//adds a byte to the ring, or counts it as dropped when the ring is full
+RAMFUNC_TWIN(void, rxRingPut, (uint8_t c),
+    uint16_t next = (rxHead + 1) % RXRINGSIZE;
+    if (next == rxTail)
+        rxOverflows++;
+    else
+    {
+        rxRing[rxHead] = c;
+        rxHead = next;
+    }
+)
+
+RAMFUNC void EUSCIA0_IRQHandler(void) {//overrides the weak handler in the startup file, runs from SRAM
+    uint16_t status;
+    uint8_t c;
+
+    if ((UCA0IE & UCTXIE) && (UCA0IFG & UCTXIFG))//only the benchmark uses the TX interrupt
+        benchTransmit();
+    if (!(UCA0IFG & UCRXIFG))
+        return;
+
+    status = UCA0STATW;//reading RXBUF clears the error bits
+    c = UART_receiveData(EUSCI_A0_BASE);//reading clears the flag
+
+    if (status & UCOE)
+        rxOverruns++;
+    if (status & UCBRK)//also a framing error, a break has no stop bit
+    {
+        rxBreaks++;
+        rxBreakAt = rxHead;
+        autoBaudSync = true;
+        return;
+    }
+    if (autoBaudSync)//the eUSCI has just loaded what it measured on c
+    {
+        autoBaudSync = false;
+        if (autoBaudArmed && c == 0x55 && !(status & UCRXERR))
+        {
+            autoBaudRate = UARTMeasuredBaud();
+            autoBaudDone = true;
+            autoBaudArmed = false;
+            UARTLoadBaud(autoBaudRate);
+            return;
+        }
+        UARTLoadBaud(baudRate);//not a sync field, back to the rate we were on
+    }
+    if (status & UCRXERR)
+    {
+        if (status & UCFE)
+        {
+            rxFramingErrors++;
+            autoBaudArmed = true;
+        }
+        if (status & UCPE)
+            rxParityErrors++;
+        if (status & (UCFE | UCPE))
+            return;
+    }
+    autoBaudArmed = false;//the host is on our rate
+    rxRingPut(c);
+}
+
+void UARTEnableRxInterrupt() {//UART_initModule resets the enables, so this follows every init
+    UCA0ABCTL |= UCABDEN;//measure the sync field after a break
+    UART_enableInterrupt(EUSCI_A0_BASE, EUSCI_A_UART_RECEIVE_INTERRUPT | EUSCI_A_UART_BREAKCHAR_INTERRUPT |
+                                        EUSCI_A_UART_RECEIVE_ERRONEOUSCHAR_INTERRUPT);//errors still interrupt, to be counted
+    Interrupt_enableInterrupt(INT_EUSCIA0);
+}
+
+void PaneStartPorts();
+
 void InitUART() {//initializing UART
     UART_initModule(EUSCI_A0_BASE, &uartConfig);
     UART_enableModule(EUSCI_A0_BASE);
     GPIO_setAsPeripheralModuleFunctionInputPin(GPIO_PORT_P1,
         GPIO_PIN2 | GPIO_PIN3, GPIO_PRIMARY_MODULE_FUNCTION);
+    UARTEnableRxInterrupt();
+    PaneStartPorts();
+    Interrupt_enableMaster();
 }
 
-bool UARTHasChar() {//if UART has a char typed in the terminal
-    return (UART_getInterruptStatus (EUSCI_A0_BASE, EUSCI_A_UART_RECEIVE_INTERRUPT_FLAG)
-                == EUSCI_A_UART_RECEIVE_INTERRUPT_FLAG);
+RAMFUNC bool UARTHasChar() {//if UART has a char typed in the terminal
+    return rxHead != rxTail;
 }
 
-uint8_t UARTGetChar() {//get the character from UART
-    if (UARTHasChar())
-        return UART_receiveData(EUSCI_A0_BASE);
-    else
+//get the character from UART
+RAMFUNC_TWIN(uint8_t, UARTGetChar, (void),
+    uint8_t c;
+    if (!UARTHasChar())
         return 0;
+    c = rxRing[rxTail];
+    rxTail = (rxTail + 1) % RXRINGSIZE;
+    return c;
+)
+
+bool UARTAtBreak() {//everything received before the last break has been read
+    return rxBreakAt == (int16_t)rxTail;
+}
+
+void UARTClearBreak() {
+    rxBreakAt = -1;
+}
+
+uint16_t UARTRxFree() {//bytes the ring can still take
+    return RXRINGSIZE - 1 - (uint16_t)((rxHead - rxTail + RXRINGSIZE) % RXRINGSIZE);
 }
 
 bool UARTCanSend() {
@@ -130,70 +621,308 @@ void UARTPutChar(uint8_t t) {//write the char to the terminal on MOba
     UART_transmitData(EUSCI_A0_BASE,t);
 }
 
+//Optional XON/XOFF for plain terminals, switched on with #w1. XOFF goes out
+//when the ring is half full, which still leaves ~45ms at 57600 for the host
+//to stop, and XON once it has drained again.
+#define XON 0x11
+#define XOFF 0x13
+#define RXHIGHWATER (RXRINGSIZE / 2)
+#define RXLOWWATER (RXRINGSIZE / 8)
+bool xonXoff = false;
+static bool rxStopped = false;//XOFF sent and not yet taken back
+
+void UARTFlowControl() {//called from the main loop, TX is not used from the interrupt
+    uint16_t used = RXRINGSIZE - 1 - UARTRxFree();
+
+    if (!xonXoff)
+    {
+        if (rxStopped)//switched off while stopped, let the host go on
+        {
+            UARTPutChar(XON);
+            rxStopped = false;
+        }
+        return;
+    }
+    if (!rxStopped && used >= RXHIGHWATER)
+    {
+        UARTPutChar(XOFF);
+        rxStopped = true;
+    }
+    else if (rxStopped && used <= RXLOWWATER)
+    {
+        UARTPutChar(XON);
+        rxStopped = false;
+    }
+}
+
+void UARTPutString(const char *s) {//write a zero terminated string to the terminal
+    while (*s)
+        UARTPutChar(*s++);
+}
+
+void UARTPutNumber(uint32_t n) {//write an unsigned number in decimal
+    char digits[10];
+    int i = 0;
+
+    do {
+        digits[i++] = n % 10 + '0';
+        n /= 10;
+    } while (n);
+    while (i)
+        UARTPutChar(digits[--i]);
+}
+
+//UCBRx, UCBRFx and UCBRSx for each UARTBaudRate_t, worked out as above
+const uint32_t baudValues[] = {9600, 19200, 38400, 57600};
+const uint8_t baudBR[] = {19, 9, 4, 3};
+const uint8_t baudBRF[] = {8, 12, 14, 4};
+const uint8_t baudBRS[] = {0xAA, 0x44, 0x10, 0x04};
+
+#define UARTIDLESPIN 2000 //~3ms, longer than one character at 9600
+
+//Switching is announced at the old rate, then the last byte is allowed to
+//finish and only the baud rate registers are rewritten. The module isn't
+//initialized again, so the RX ring, and everything the parser is halfway
+//through, carries on at the new rate. After auto baud the interrupt has
+//loaded the rate already, and the registers are left alone, as a second
+//reset would drop the first byte the host sends after the sync.
 void UARTSetBaud() {//set the proper baud rate of the 4 possible options
-    if (baudRate == 0)//baud rate is 9600
-    {
-        eUSCI_UART_Config uartConfig = {
-             EUSCI_A_UART_CLOCKSOURCE_SMCLK,               // SMCLK Clock Source = 3MHz
-             19,                                           // UCBR   = 19
-             8,                                            // UCBRF  = 8
-             0xAA,                                         // UCBRS  = 0xAA
-             EUSCI_A_UART_NO_PARITY,                       // No Parity
-             EUSCI_A_UART_LSB_FIRST,                       // LSB First
-             EUSCI_A_UART_ONE_STOP_BIT,                    // One stop bit
-             EUSCI_A_UART_MODE,                            // UART mode
-             EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION // Oversampling
-        };
-        UART_initModule(EUSCI_A0_BASE, &uartConfig);
-        UART_enableModule(EUSCI_A0_BASE);
-    }
-    else if (baudRate == 1)//baud rate is 19200
-    {
-        eUSCI_UART_Config uartConfig = {
-             EUSCI_A_UART_CLOCKSOURCE_SMCLK,               // SMCLK Clock Source = 3MHz
-             9,                                           // UCBR   = 19
-             12,                                            // UCBRF  = 8
-             0x44,                                         // UCBRS  = 0xAA
-             EUSCI_A_UART_NO_PARITY,                       // No Parity
-             EUSCI_A_UART_LSB_FIRST,                       // LSB First
-             EUSCI_A_UART_ONE_STOP_BIT,                    // One stop bit
-             EUSCI_A_UART_MODE,                            // UART mode
-             EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION // Oversampling
-        };
-        UART_initModule(EUSCI_A0_BASE, &uartConfig);
-        UART_enableModule(EUSCI_A0_BASE);
-    }
-    else if (baudRate == 2)//baud rate is 38400
-    {
-        eUSCI_UART_Config uartConfig = {
-             EUSCI_A_UART_CLOCKSOURCE_SMCLK,               // SMCLK Clock Source = 3MHz
-             4,                                           // UCBR   = 19
-             14,                                            // UCBRF  = 8
-             0x10,                                         // UCBRS  = 0xAA
-             EUSCI_A_UART_NO_PARITY,                       // No Parity
-             EUSCI_A_UART_LSB_FIRST,                       // LSB First
-             EUSCI_A_UART_ONE_STOP_BIT,                    // One stop bit
-             EUSCI_A_UART_MODE,                            // UART mode
-             EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION // Oversampling
-        };
-        UART_initModule(EUSCI_A0_BASE, &uartConfig);
-        UART_enableModule(EUSCI_A0_BASE);
-    }
-    else if (baudRate == 3)//baud rate is 57600
-    {
-        eUSCI_UART_Config uartConfig = {
-             EUSCI_A_UART_CLOCKSOURCE_SMCLK,               // SMCLK Clock Source = 3MHz
-             3,                                           // UCBR   = 19
-             4,                                            // UCBRF  = 8
-             0x04,                                         // UCBRS  = 0xAA
-             EUSCI_A_UART_NO_PARITY,                       // No Parity
-             EUSCI_A_UART_LSB_FIRST,                       // LSB First
-             EUSCI_A_UART_ONE_STOP_BIT,                    // One stop bit
-             EUSCI_A_UART_MODE,                            // UART mode
-             EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION // Oversampling
-        };
-        UART_initModule(EUSCI_A0_BASE, &uartConfig);
-        UART_enableModule(EUSCI_A0_BASE);
+    int i;
+
+    if (uartEcho)//not in framed mode, where it would land in the middle of the frames
+    {
+        UARTPutString("\r\nbaud ");
+        UARTPutNumber(baudValues[baudRate]);
+        UARTPutString("\r\n");
+    }
+    while (!UARTCanSend()) ;//last byte has gone to the shift register
+    for (i = 0; i < UARTIDLESPIN && (UCA0STATW & UCBUSY); i++) ;//and out of it, unless the host never pauses
+
+    UARTLoadBaud(baudRate);
+    PaneStartPorts();//the panes follow the console rate
+}
+
+void UARTLoadBaud(UARTBaudRate_t rate) {//the table divider for rate, straight away
+    uint16_t mctlw = (baudBRS[rate] << 8) | (baudBRF[rate] << 4) | UCOS16;
+
+    Interrupt_disableInterrupt(INT_EUSCIA0);//the RX interrupt loads rates too, one at a time
+    if (UCA0BRW != baudBR[rate] || UCA0MCTLW != mctlw)//on it already, a reset would only drop a byte
+    {
+        UCA0CTLW0 |= UCSWRST;
+        UCA0BRW = baudBR[rate];
+        UCA0MCTLW = mctlw;
+        UCA0CTLW0 &= ~UCSWRST;
+        UARTEnableRxInterrupt();//UCSWRST cleared the enables
+    }
+    Interrupt_enableInterrupt(INT_EUSCIA0);
+}
+
+const uint16_t baudDividers[] = {313, 156, 78, 52};//3MHz / rate, indexed by UARTBaudRate_t
+
+UARTBaudRate_t UARTMeasuredBaud() {//the supported rate closest to what auto baud loaded
+    uint16_t measured, diff, bestDiff = 0xFFFF;
+    int i, best = baudRate;
+
+    measured = UCA0BRW * 16 + ((UCA0MCTLW >> 4) & 0x0F);//UCBRx and UCBRFx, oversampling
+    for (i = 0; i < 4; i++)
+    {
+        diff = (measured > baudDividers[i]) ? measured - baudDividers[i] : baudDividers[i] - measured;
+        if (diff < bestDiff)
+        {
+            bestDiff = diff;
+            best = i;
+        }
+    }
+    return (UARTBaudRate_t)best;
+}
+
+void cmdAutoBaud(uint32_t arg) {//#a, the next break and 0x55 set the rate
+    (void)arg;
+    autoBaudArmed = true;
+}
+
+bool UARTAutoBaud() {//true if a sync field was measured and baudRate changed to match it
+    if (!autoBaudDone)
+        return false;
+    autoBaudDone = false;
+
+    baudRate = autoBaudRate;
+    baudAuto = true;
+    UARTSetBaud();//the interrupt already runs at the new rate, this announces it
+    return true;
+}
+
+//------------------------------------------
+// Terminal panes
+//
+// EUSCI_A1 (P2.2/P2.3), EUSCI_A2 (P3.2/P3.3) and EUSCI_A3 (P9.6/P9.7) can feed
+// terminals of their own next to the console. #t<n> splits the text rows
+// into n panes, top to bottom, the console first. Each pane UART has its own
+// RX ring filled by its interrupt, runs at the console baud rate and echoes
+// on its own TX. The main loop takes at most PANEBATCH bytes from each UART
+// in turn, so a busy stream can't keep the others from being drawn.
+
+#define PANERINGSIZE 128 //~22ms at 57600, each ring is looked at every pass
+#define PANEBATCH 16 //bytes per pane per pass, same as the console
+
+typedef struct {
+    volatile uint8_t buf[PANERINGSIZE];
+    volatile uint16_t head, tail;
+    volatile uint32_t overflows;//bytes dropped because the ring was full
+} paneRing_t;
+
+static paneRing_t paneRings[NUMPORTS - 1];//pane i uses paneRings[i - 1], the console has rxRing
+
+const uint32_t paneBases[NUMPORTS] = {EUSCI_A0_BASE, EUSCI_A1_BASE, EUSCI_A2_BASE, EUSCI_A3_BASE};
+const uint8_t paneGpioPorts[NUMPORTS] = {GPIO_PORT_P1, GPIO_PORT_P2, GPIO_PORT_P3, GPIO_PORT_P9};
+const uint16_t panePins[NUMPORTS] = {GPIO_PIN2 | GPIO_PIN3, GPIO_PIN2 | GPIO_PIN3, GPIO_PIN2 | GPIO_PIN3, GPIO_PIN6 | GPIO_PIN7};
+const uint32_t paneInts[NUMPORTS] = {INT_EUSCIA0, INT_EUSCIA1, INT_EUSCIA2, INT_EUSCIA3};
+const color_t paneBg[NUMPORTS] = {blue, black, blue, black};//neighbouring panes start out different
+
+//bytes with an error never set RXIFG, the error interrupt is left off
+RAMFUNC void paneReceive(int i) {
+    paneRing_t *ring = &paneRings[i - 1];
+    uint8_t c = UART_receiveData(paneBases[i]);//reading clears the flag
+    uint16_t next = (ring->head + 1) % PANERINGSIZE;
+
+    if (next == ring->tail)
+        ring->overflows++;
+    else
+    {
+        ring->buf[ring->head] = c;
+        ring->head = next;
+    }
+}
+
+RAMFUNC void EUSCIA1_IRQHandler(void) { paneReceive(1); }
+RAMFUNC void EUSCIA2_IRQHandler(void) { paneReceive(2); }
+RAMFUNC void EUSCIA3_IRQHandler(void) { paneReceive(3); }
+
+bool PaneHasChar(int i) {
+    return paneRings[i - 1].head != paneRings[i - 1].tail;
+}
+
+uint8_t PaneGetChar(int i) {
+    paneRing_t *ring = &paneRings[i - 1];
+    uint8_t c = ring->buf[ring->tail];
+    ring->tail = (ring->tail + 1) % PANERINGSIZE;
+    return c;
+}
+
+void PanePutChar(uint32_t port, uint8_t c) {
+    while (UART_getInterruptStatus(port, EUSCI_A_UART_TRANSMIT_INTERRUPT_FLAG) != EUSCI_A_UART_TRANSMIT_INTERRUPT_FLAG) ;
+    UART_transmitData(port, c);
+}
+
+bool PaneWaiting() {//any pane ring with something in it
+    int i;
+
+    for (i = 1; i < paneCount; i++)
+        if (PaneHasChar(i))
+            return true;
+    return false;
+}
+
+uint32_t PaneOverflows() {//all pane rings together
+    uint32_t total = 0;
+    int i;
+
+    for (i = 1; i < NUMPORTS; i++)
+        total += paneRings[i - 1].overflows;
+    return total;
+}
+
+void PaneStartPorts() {//UARTs of the panes on at the console rate, the others off
+    eUSCI_UART_Config config = uartConfig;
+    int i;
+
+    config.clockPrescalar = baudBR[baudRate];
+    config.firstModReg = baudBRF[baudRate];
+    config.secondModReg = baudBRS[baudRate];
+    config.uartMode = EUSCI_A_UART_MODE;//only the console does auto baud
+
+    for (i = 1; i < NUMPORTS; i++)
+    {
+        Interrupt_disableInterrupt(paneInts[i]);
+        if (i >= paneCount)
+        {
+            UART_disableModule(paneBases[i]);
+            continue;
+        }
+        UART_initModule(paneBases[i], &config);
+        UART_enableModule(paneBases[i]);
+        GPIO_setAsPeripheralModuleFunctionInputPin(paneGpioPorts[i], panePins[i], GPIO_PRIMARY_MODULE_FUNCTION);
+        UART_enableInterrupt(paneBases[i], EUSCI_A_UART_RECEIVE_INTERRUPT);
+        Interrupt_enableInterrupt(paneInts[i]);
+    }
+}
+
+void TermInit(int i) {//white on the pane's background, nothing half parsed
+    term_t *t = &terms[i];
+
+    memset(t, 0, sizeof(*t));
+    t->port = paneBases[i];
+    t->fg = t->defaultFg = white;
+    t->bg = t->defaultBg = paneBg[i];
+    t->fgPixel = colorTable[t->fg];
+    t->bgPixel = colorTable[t->bg];
+    t->presentState = idle;
+}
+
+void InitTerms() {//before the settings store puts the console colors back
+    int i;
+
+    for (i = 0; i < NUMPORTS; i++)
+        TermInit(i);
+}
+
+void TermSelect(int i) {//parse and draw for terminal i from here on
+    term = &terms[i];
+}
+
+void PaneLayout() {//split the text rows between the panes and put the cursors at the top
+    int rows = termRows - STARTROW, top = STARTROW, i;
+
+    for (i = 0; i < NUMPORTS; i++)
+    {
+        terms[i].top = top;
+        terms[i].rows = (i < paneCount) ? rows / paneCount + (i < rows % paneCount) : 0;
+        top += terms[i].rows;
+        terms[i].rowNum = terms[i].savedRow = terms[i].top;
+        terms[i].colNum = terms[i].savedCol = 0;
+        if (i != CONSOLE)//a pane that comes back starts afresh
+            terms[i].presentState = idle;
+    }
+}
+
+void cmdPanes(uint32_t arg) {//#t<n>, n terminals share the text rows, #t1 is the console alone
+    int i;
+
+    paneCount = arg ? arg : 1;
+    PaneStartPorts();
+    PaneLayout();
+    for (i = paneCount - 1; i >= 0; i--)//ends on the console
+    {
+        TermSelect(i);
+        LCDClearText();
+    }
+}
+
+void PanePoll() {//one batch from each pane UART with something waiting, in its own terminal
+    uint8_t batch[PANEBATCH];
+    int i, n;
+
+    for (i = 1; i < paneCount; i++)
+    {
+        n = 0;
+        while (n < (int)sizeof(batch) && PaneHasChar(i))
+            batch[n++] = PaneGetChar(i);
+        if (n == 0)
+            continue;
+        TermSelect(i);
+        charCounter += n;
+        parseCommands(batch, n);
+        TermSelect(CONSOLE);
     }
 }
 
@@ -254,79 +983,21 @@ void ColorLEDSet(color_t t) {//set the color based on the color passed in
         GPIO_setOutputHighOnPin(GPIO_PORT_P2, GPIO_PIN4);
         GPIO_setOutputHighOnPin(GPIO_PORT_P5, GPIO_PIN6);
         break;
+    case custom://the LED only has the eight basic colors
+        break;
     }
 }
 
-//uses global variable fgs
+//uses term->fg
 void LCDSetFgColor() {//function that sets the foreground color based on function call
-    if (fg == 0)//c is black
-    {
-        Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_BLACK);
-    }
-    else if (fg == 1)//c is red
-    {
-        Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_RED);
-    }
-    else if(fg == 2)//c is green
-    {
-        Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_GREEN);
-    }
-    else if (fg == 3)//c is yellow
-    {
-        Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_YELLOW);
-    }
-    else if (fg == 4)//c is blue
-    {
-        Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_BLUE);
-    }
-    else if (fg == 5)//c is magenta
-    {
-        Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_MAGENTA);
-    }
-    else if (fg == 6)//c is cyan
-    {
-        Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_CYAN);
-    }
-    else if (fg == 7)//c is white
-    {
-        Graphics_setForegroundColor(&g_sContext, GRAPHICS_COLOR_WHITE);
-    }
+    term->fgPixel = (term->fg == custom) ? term->customFgPixel : colorTable[term->fg];
+    Graphics_setForegroundColorTranslated(&g_sContext, SWAP16(term->fgPixel));//GRLIB takes plain RGB565
 }
 
-//uses global variable bg
+//uses term->bg
 void LCDSetBgColor() {
-    if (bg == 0)//c is black
-    {
-        Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_BLACK);
-    }
-    else if (bg == 1)//c is red
-    {
-        Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_RED);
-    }
-    else if(bg == 2)//c is green
-    {
-        Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_GREEN);
-    }
-    else if (bg == 3)//c is yellow
-    {
-        Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_YELLOW);
-    }
-    else if (bg == 4)//c is blue
-    {
-        Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_BLUE);
-    }
-    else if (bg == 5)//c is magenta
-    {
-        Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_MAGENTA);
-    }
-    else if (bg == 6)//c is cyan
-    {
-        Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_CYAN);
-    }
-    else if (bg == 7)//c is white
-    {
-        Graphics_setBackgroundColor(&g_sContext, GRAPHICS_COLOR_WHITE);
-    }
+    term->bgPixel = (term->bg == custom) ? term->customBgPixel : colorTable[term->bg];
+    Graphics_setBackgroundColorTranslated(&g_sContext, SWAP16(term->bgPixel));
 }
 
 void InitTimerDebounce() {//debounce timer
@@ -356,25 +1027,117 @@ int Timer200msExpiredOneShot() {//if timer has expired or not
 }
 
 //------------------------------------------
-// Debounce FSM for S2
+// Cycle counter API
 //
+// The Cortex-M4 DWT cycle counter runs at MCLK and is used to time the
+// drawing code. At the default 3MHz, one cycle is 333ns.
+
+uint32_t statusDrawCycles = 0;//last status screen draw, one run per row
+uint32_t statusDrawCharCycles = 0;//same screen drawn one LCDDrawChar per character
+uint32_t statusDrawBytes = 0;//bytes the run draw put on the SPI
+uint32_t imagePixels = 0, imageCycles = 0, imageBytes = 0;//last #i or #q upload that finished
+bool crcHardware = false;//CRC32 module in use, see InitCRC32
+uint32_t crcHardwareCycles = 0, crcSoftwareCycles = 0;//time for 256 bytes, measured at start up
+uint32_t framesGood = 0, framesBad = 0;
+uint32_t bootStart = 0, bootCycles = 0;//from the top of main to the status rows on the panel
+int settingsSector = 0, settingsNext = 0;//settings store, where the next record goes
+uint32_t settingsSeq = 0, settingsSaves = 0;
+
+void InitCycleCounter() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
 
-bool BounceFSM(bool *button) {
-
-    /*stable0, trans0to1, stable1, trans1to0*/
-    static state_t currentState = stable0;
-
-    bool checkTimerExpiration = TimerDebounceExpiredOneShot();//bool to check if timer expired or not
+uint32_t CycleCount() {
+    return DWT->CYCCNT;
+}
 
-    bool debounced = false;
-    bool timerStart = false;
+//------------------------------------------
+// Button gestures
+//
+// A press shorter than LONGPRESS is reported as gestureShort when the button
+// is released. A longer one is reported as gestureLong once it has been held
+// that long, and again every LONGREPEAT while it stays down. Level changes
+// shorter than holdOff are ignored: GESTUREDEBOUNCE for a raw pin, 0 for S2,
+// which BounceFSM has debounced already, so its delays don't add up.
+
+#define CYCLES_PER_MS 3000 //MCLK is 3MHz
+#define GESTUREDEBOUNCE (20 * CYCLES_PER_MS)
+#define LONGPRESS (800 * CYCLES_PER_MS)
+#define LONGREPEAT (400 * CYCLES_PER_MS)
+
+typedef enum {gestureNone, gestureShort, gestureLong} gesture_t;
+
+typedef struct {
+    bool down;//debounced level
+    bool changing;//level has differed from down since changedAt
+    bool longSent;
+    uint32_t changedAt, downAt, repeatAt;
+} gestureFSM_t;
+
+gesture_t ButtonGesture(gestureFSM_t *g, bool pressed, uint32_t holdOff)
+{
+    uint32_t now = CycleCount();
 
-    switch (currentState)
+    if (pressed != g->down)
     {
-    case stable0:
-        if (*button == 1)
+        if (!g->changing)
         {
-            currentState = trans0to1;
+            g->changing = true;
+            g->changedAt = now;
+        }
+        if (now - g->changedAt >= holdOff)
+        {
+            g->changing = false;
+            g->down = pressed;
+            if (pressed)
+            {
+                g->downAt = now;
+                g->longSent = false;
+            }
+            else if (!g->longSent)
+            {
+                return gestureShort;
+            }
+        }
+        return gestureNone;
+    }
+
+    g->changing = false;
+    if (g->down && !g->longSent && now - g->downAt >= LONGPRESS)
+    {
+        g->longSent = true;
+        g->repeatAt = now;
+        return gestureLong;
+    }
+    if (g->down && g->longSent && now - g->repeatAt >= LONGREPEAT)
+    {
+        g->repeatAt = now;
+        return gestureLong;
+    }
+    return gestureNone;
+}
+
+//------------------------------------------
+// Debounce FSM for S2
+//
+
+bool BounceFSM(bool *button) {
+
+    /*stable0, trans0to1, stable1, trans1to0*/
+    static state_t currentState = stable0;
+
+    bool checkTimerExpiration = TimerDebounceExpiredOneShot();//bool to check if timer expired or not
+
+    bool debounced = false;
+    bool timerStart = false;
+
+    switch (currentState)
+    {
+    case stable0:
+        if (*button == 1)
+        {
+            currentState = trans0to1;
             timerStart = true;
         }
         break;
@@ -446,161 +1209,444 @@ int ButtonS2Pressed() {//if button 2 is pressed or not
     return (GPIO_getInputPinValue(GPIO_PORT_P3, GPIO_PIN5) == 0);
 }
 
-//Functions that I have written for implementation
-void write2LCD(uint8_t inChar)//function
+//------------------------------------------
+// Scrollback
+//
+// Every text row the cursor leaves is copied into a ring of SCROLLBACK_LINES
+// lines. Paging shows older lines in the text rows; only the cells that differ
+// from what is on the panel are redrawn, as runs of one attribute, and the
+// live screen is put back from screenChars/screenAttrs the same way. Paging
+// only picks the view; the render task redraws it a row at a time within
+// its slice, so a page of text doesn't hold the UART up. New text puts the
+// live screen back at once.
+
+char historyChars[SCROLLBACK_LINES][MAXCOLS];
+uint8_t historyAttrs[SCROLLBACK_LINES][MAXCOLS];
+int historyNext = 0;//ring slot the next line goes into
+int historyCount = 0;
+static uint8_t blankAttrs[MAXCOLS];
+
+void scrollbackAppend(int row)//save a screen row, trailing blanks become padding
 {
-    //the following code writes to the LCD display
-       LCDDrawChar(rowNum, colNum, inChar);
-       colNum += 1;
+    int col, len = termCols;
 
-       if (colNum == 16)//used to print to next row and wrapping around
-       {
-           colNum = 0;
-           rowNum += 1;
-       }
-}//end of outputting to LCD display
+    while (len > 0 && screenChars[row][len - 1] == ' ' && screenAttrs[row][len - 1] == currentAttr())
+        len--;
+    for (col = 0; col < MAXCOLS; col++)
+    {
+        historyChars[historyNext][col] = (col < len) ? screenChars[row][col] : ' ';
+        historyAttrs[historyNext][col] = (col < len) ? screenAttrs[row][col] : currentAttr();
+    }
+    historyNext = (historyNext + 1) % SCROLLBACK_LINES;
+    if (historyCount < SCROLLBACK_LINES)
+        historyCount++;
+}
 
-void printMessageLCD()
+void viewLine(int view, int row, const char **chars, const uint8_t **attrs)//console row as seen in a view
 {
-    int col = 0;
+    int line, slot;
 
-    if (baudRate == 0)//determing baud rate and print accordingly to LCD
+    if (view == 0)
+    {
+        *chars = screenChars[terms[CONSOLE].top + row];
+        *attrs = screenAttrs[terms[CONSOLE].top + row];
+        return;
+    }
+    line = historyCount - view - (terms[CONSOLE].rows - 1) + row;//0 is the oldest line kept
+    if (line < 0)
     {
-        LCDDrawChar(STATUSROW1, col, 'b');
-        LCDDrawChar(STATUSROW1, col+1, 'd');
-        LCDDrawChar(STATUSROW1, col+2, ' ');
-        LCDDrawChar(STATUSROW1, col+3, '9');
-        LCDDrawChar(STATUSROW1, col+4, '6');
-        LCDDrawChar(STATUSROW1, col+5, '0');
-        LCDDrawChar(STATUSROW1, col+6, '0');
+        *chars = blankRow;
+        *attrs = blankAttrs;
+        return;
     }
-    else if (baudRate == 1)
+    slot = (historyNext - historyCount + line + SCROLLBACK_LINES) % SCROLLBACK_LINES;
+    *chars = historyChars[slot];
+    *attrs = historyAttrs[slot];
+}
+
+void LCDDrawRunAttr(int row, int col, const char *str, int len, uint8_t attr)//draw in other colors
+{
+    color_t saveFg = term->fg, saveBg = term->bg;
+
+    if (attr != currentAttr())
     {
-        LCDDrawChar(STATUSROW1, col, 'b');
-        LCDDrawChar(STATUSROW1, col+1, 'd');
-        LCDDrawChar(STATUSROW1, col+2, '1');
-        LCDDrawChar(STATUSROW1, col+3, '9');
-        LCDDrawChar(STATUSROW1, col+4, '2');
-        LCDDrawChar(STATUSROW1, col+5, '0');
-        LCDDrawChar(STATUSROW1, col+6, '0');
+        term->fg = (color_t)(attr & 0xF);
+        term->bg = (color_t)(attr >> 4);
+        LCDSetFgColor();
+        LCDSetBgColor();
     }
-    else if (baudRate == 2)
+    LCDDrawRun(row, col, str, len);
+    if (term->fg != saveFg || term->bg != saveBg)
     {
-        LCDDrawChar(STATUSROW1, col, 'b');
-        LCDDrawChar(STATUSROW1, col+1, 'd');
-        LCDDrawChar(STATUSROW1, col+2, '3');
-        LCDDrawChar(STATUSROW1, col+3, '8');
-        LCDDrawChar(STATUSROW1, col+4, '4');
-        LCDDrawChar(STATUSROW1, col+5, '0');
-        LCDDrawChar(STATUSROW1, col+6, '0');
+        term->fg = saveFg;
+        term->bg = saveBg;
+        LCDSetFgColor();
+        LCDSetBgColor();
     }
-    else if (baudRate == 3)
+}
+
+void LCDShowHistory(int view)//view is the number of lines scrolled back, 0 for the live screen
+{
+    int rows = terms[CONSOLE].rows;
+    int maxView = (historyCount > rows) ? historyCount - rows + 1 : 1;
+
+    if (historyCount == 0 || view < 0)
+        view = 0;
+    if (view > maxView)
+        view = maxView;
+    if (view == historyView)
+        return;
+    if (historyView == 0)//the live rows go on the panel first, paging only redraws what differs
+        LCDRenderFrame();
+    if (historyCol > 0)//a row was left half drawn, it is redrawn in full
     {
-        LCDDrawChar(STATUSROW1, col, 'b');
-        LCDDrawChar(STATUSROW1, col+1, 'd');
-        LCDDrawChar(STATUSROW1, col+2, '5');
-        LCDDrawChar(STATUSROW1, col+3, '7');
-        LCDDrawChar(STATUSROW1, col+4, '6');
-        LCDDrawChar(STATUSROW1, col+5, '0');
-        LCDDrawChar(STATUSROW1, col+6, '0');
+        rowView[historyHalfRow()] = -1;
+        historyCol = 0;
     }
+    historyView = view;//drawn by LCDHistoryStep, a few runs at a time
+    historyPending = true;
+}
 
-    LCDDrawChar(STATUSROW1, col+9, 'f');//print fg color number and print number as char
-    LCDDrawChar(STATUSROW1, col+10, 'g');
-    LCDDrawChar(STATUSROW1, col+11, fg + '0');
+bool LCDHistoryStep(uint32_t budget)//redraw console rows until they show historyView, false if the budget ran out first
+{
+    int rows = terms[CONSOLE].rows;
+    int row, col, start;
+    uint32_t begin = CycleCount();
+
+    if (!historyPending)
+        return true;
 
-    LCDDrawChar(STATUSROW1, col+13, 'b');//print bg color number and print number as char
-    LCDDrawChar(STATUSROW1, col+14, 'g');
-    LCDDrawChar(STATUSROW1, col+15, bg + '0');
+    LCDRenderFrame();//the other panes' text, the console rows are drawn from here
+    for (col = 0; col < MAXCOLS; col++)
+        blankAttrs[col] = currentAttr();
+
+    for (row = 0; row < rows; row++)
+    {
+        const char *oldChars, *newChars;
+        const uint8_t *oldAttrs, *newAttrs;
+        bool mixed = rowView[row] < 0;//nothing known about what is on the panel
 
-    LCDDrawChar(STATUSROW2, col, 'n');
+        if (rowView[row] == historyView)
+            continue;
+        viewLine(mixed ? 0 : rowView[row], row, &oldChars, &oldAttrs);
+        viewLine(historyView, row, &newChars, &newAttrs);
 
-    int one, two, three, four;//variables for each digit
+        col = historyCol;
+        while (col < termCols)
+        {
+            if (!mixed && newChars[col] == oldChars[col] && newAttrs[col] == oldAttrs[col])//already on the panel
+            {
+                col++;
+                continue;
+            }
+            start = col;//changed cells with the same attribute go out as one run
+            while (col < termCols && newAttrs[col] == newAttrs[start] &&
+                   (mixed || newChars[col] != oldChars[col] || newAttrs[col] != oldAttrs[col]))
+                col++;
+            LCDDrawRunAttr(terms[CONSOLE].top + row, start, newChars + start, col - start, newAttrs[start]);
+            if (col < termCols && CycleCount() - begin >= budget)//yield between runs, the rest is drawn next time
+            {
+                historyCol = col;
+                return false;
+            }
+        }
+        historyCol = 0;
+        rowView[row] = historyView;
+        if (CycleCount() - begin >= budget)
+            break;
+    }
+    for (row = 0; row < rows && rowView[row] == historyView; row++) ;
+    historyPending = row < rows;
+    return !historyPending;
+}
 
-    one = charCounter / 1000;//calculations to extract each digit
-    two = charCounter / 100 % 10;
-    three = charCounter /10 % 10;
-    four = charCounter % 10;
+void LCDShowLive()//back to the live screen right away, before new text is drawn
+{
+    LCDShowHistory(0);
+    LCDHistoryStep(0xFFFFFFFF);
+}
 
-    LCDDrawChar(STATUSROW2, col+1, ' ');//print each digit as char
-    LCDDrawChar(STATUSROW2, col+2, one + '0');
-    LCDDrawChar(STATUSROW2, col+3, two + '0');
-    LCDDrawChar(STATUSROW2, col+4, three + '0');
-    LCDDrawChar(STATUSROW2, col+5, four + '0');
+void LCDPageHistory(int direction)//+1 for one page older, -1 for one page newer
+{
+    int rows = terms[CONSOLE].rows;
 
-    rowNum = STATUSROW2 + 1;//start on row 2 col 0 after displaying status message
-    colNum = 0;
+    if (direction > 0)
+        LCDShowHistory(historyView == 0 ? 1 : historyView + rows);
+    else
+        LCDShowHistory(historyView <= rows ? 0 : historyView - rows);
 }
 
-void printMessageUART()
+void LCDEraseCells(int row, int col, int count)//fill cells with the background color
 {
-    int col = 0;
+    int i;
 
-    if (baudRate == 0)//determing baud rate and print accordingly to LCD
+    for (i = col; i < col + count && i < MAXCOLS; i++)
     {
-        UARTPutChar('b');
-        UARTPutChar('d');
-        UARTPutChar(' ');
-        UARTPutChar('9');
-        UARTPutChar('6');
-        UARTPutChar('0');
-        UARTPutChar('0');
+        screenChars[row][i] = ' ';
+        screenAttrs[row][i] = currentAttr();
     }
-    else if (baudRate == 1)
+    if (i > col)
+        markDirty(row, col, i - 1);
+}
+
+//Functions that I have written for implementation
+void write2LCD(uint8_t inChar)//function
+{
+    if (inChar == '\r')//carriage return, back to the start of the row
     {
-        UARTPutChar('b');
-       UARTPutChar('d');
-       UARTPutChar('1');
-       UARTPutChar('9');
-       UARTPutChar('2');
-       UARTPutChar('0');
-       UARTPutChar('0');
+        term->colNum = 0;
+        return;
     }
-    else if (baudRate == 2)
+    if (inChar == '\b')//backspace, stays on the row
     {
-        UARTPutChar('b');
-       UARTPutChar('d');
-       UARTPutChar('3');
-       UARTPutChar('8');
-       UARTPutChar('4');
-       UARTPutChar('0');
-       UARTPutChar('0');
+        if (term->colNum > 0)
+            term->colNum -= 1;
+        return;
     }
-    else if (baudRate == 3)
-    {
-        UARTPutChar('b');
-       UARTPutChar('d');
-       UARTPutChar('5');
-       UARTPutChar('7');
-       UARTPutChar('6');
-       UARTPutChar('0');
-       UARTPutChar('0');
+    if (inChar == '\n')//line feed, down one row
+        term->colNum = termCols;
+    else
+    {
+    //the following code writes to the LCD display
+       screenChars[term->rowNum][term->colNum] = inChar;
+       screenAttrs[term->rowNum][term->colNum] = currentAttr();
+       markDirty(term->rowNum, term->colNum, term->colNum);//drawn with the rest of the frame
+       term->colNum += 1;
     }
 
-    UARTPutChar(' ');//print fg color number and print number as char
-    UARTPutChar('f');
-    UARTPutChar('g');
-    UARTPutChar(fg + '0');
+       if (term->colNum >= termCols)//used to print to next row and wrapping around
+       {
+           if (term == &terms[CONSOLE])//only the console has scrollback
+               scrollbackAppend(term->rowNum);
+           term->colNum = 0;
+           term->rowNum += 1;
+           if (term->rowNum >= term->top + term->rows)//wrap to the top of the pane
+           {
+               term->rowNum = term->top;
+           }
+           LCDEraseCells(term->rowNum, 0, termCols);//the new row starts blank, not with what the last pass left
+       }
+}//end of outputting to LCD display
 
-    UARTPutChar(' ');//print bg color number and print number as char
-    UARTPutChar('b');
-    UARTPutChar('g');
-    UARTPutChar(bg + '0');
+const char *baudNames[] = {" 9600", "19200", "38400", "57600"};//indexed by UARTBaudRate_t
 
-    UARTPutChar(' ');
-    UARTPutChar('n');
+//The status rows stay on screen and are kept up to date field by field:
+//  row 0: "bd 9600  fg7 bg4"   baud in cols 0-6, fg in 9-11, bg in 13-15
+//  row 1: "n 0042"             charCounter from col 2, at least 4 digits
+char counterText[MAXCOUNTERDIGITS];//charCounter digits as last drawn on the status row
+int counterLen = 0;
+uint32_t counterShown = 0;//charCounter as last drawn
+
+void buildStatusRow1(char *row1)//first status row, 16 characters
+{
+    int i;
+
+    row1[0] = 'b';//baud rate
+    row1[1] = 'd';
+    for (i = 0; i < 5; i++)
+        row1[2 + i] = baudNames[baudRate][i];
+    row1[7] = baudAuto ? 'a' : ' ';//rate was found by auto baud
+    row1[8] = ' ';
+    row1[9] = 'f';//fg color number as char
+    row1[10] = 'g';
+    row1[11] = (terms[CONSOLE].fg == custom) ? 'c' : terms[CONSOLE].fg + '0';
+    row1[12] = ' ';
+    row1[13] = 'b';//bg color number as char
+    row1[14] = 'g';
+    row1[15] = (terms[CONSOLE].bg == custom) ? 'c' : terms[CONSOLE].bg + '0';
+}
+
+int formatCounter(char *digits)//charCounter in decimal, zero padded to 4 digits, returns the length
+{
+    char reversed[MAXCOUNTERDIGITS];
+    uint32_t value = charCounter;
+    int len = 0, i;
+
+    do {
+        reversed[len++] = value % 10 + '0';
+        value /= 10;
+    } while (value || len < 4);
+    for (i = 0; i < len; i++)
+        digits[i] = reversed[len - 1 - i];
+    return len;
+}
+
+int buildStatusRow2(char *row2)//second status row, returns the length
+{
+    row2[0] = 'n';
+    row2[1] = ' ';
+    return 2 + formatCounter(row2 + COUNTERCOL);
+}
 
-    int one, two, three, four;//variables for each digit
+void printMessageLCD()//draw both status rows in full
+{
+    char row1[16], row2[2 + MAXCOUNTERDIGITS];
+    int len2, i;
+    uint32_t start = CycleCount();
+
+    buildStatusRow1(row1);
+    len2 = buildStatusRow2(row2);
+    LCDDrawRun(STATUSROW1, 0, row1, sizeof(row1));//one window write per status row
+    LCDDrawRun(STATUSROW2, 0, row2, len2);
+    statusDrawCycles = CycleCount() - start;
+
+    counterLen = len2 - COUNTERCOL;//remember what the counter looks like now
+    counterShown = charCounter;
+    for (i = 0; i < counterLen; i++)
+        counterText[i] = row2[COUNTERCOL + i];
+}
+
+void LCDUpdateStatusField(int first, int len)//redraw part of the first status row
+{
+    char row1[16];
+
+    buildStatusRow1(row1);
+    LCDDrawRun(STATUSROW1, first, row1 + first, len);
+}
+
+void LCDUpdateCounter()//redraw only the digits of charCounter that changed since the last draw
+{
+    char digits[MAXCOUNTERDIGITS];
+    int len = formatCounter(digits);
+    int i = 0, first;
+
+    while (i < len)
+    {
+        if (i < counterLen && digits[i] == counterText[i])
+        {
+            i++;
+            continue;
+        }
+        first = i;//draw the changed digits next to each other as one run
+        while (i < len && !(i < counterLen && digits[i] == counterText[i]))
+            i++;
+        LCDDrawRun(STATUSROW2, COUNTERCOL + first, digits + first, i - first);
+    }
+
+    for (i = 0; i < len; i++)
+        counterText[i] = digits[i];
+    counterLen = len;
+    counterShown = charCounter;
+}
+
+void LCDClearText()//clear the text rows of the pane and move the cursor back up
+{
+    int pixels = term->rows * cellHeight * LCD_HORIZONTAL_MAX;
+
+    clearScreenRows(term->top, term->rows);
+    if (term == &terms[CONSOLE])
+        historyLive();
+    imageWindowSet = false;
+    Crystalfontz128x128_QueueDrawFrame(0, term->top * cellHeight, LCD_HORIZONTAL_MAX - 1, (term->top + term->rows) * cellHeight - 1);
+    HAL_LCD_queueFill(SWAP16(term->bgPixel), pixels);
+
+    term->rowNum = term->top;
+    term->colNum = 0;
+}
+
+void LCDProfileStatusDraw()//draw the status rows one character at a time and as runs, and time both
+{
+    char row1[16], row2[2 + MAXCOUNTERDIGITS];
+    int len2, i;
+    uint32_t start;
+
+    LCDRenderFrame();//the timing is of the status rows alone
+    buildStatusRow1(row1);
+    len2 = buildStatusRow2(row2);
+
+    start = CycleCount();
+    for (i = 0; i < (int)sizeof(row1); i++)
+        LCDDrawChar(STATUSROW1, i, row1[i]);
+    for (i = 0; i < len2; i++)
+        LCDDrawChar(STATUSROW2, i, row2[i]);
+    HAL_LCD_waitQueue();//time until it is on the panel, not just queued
+    statusDrawCharCycles = CycleCount() - start;
+
+    start = CycleCount();
+    statusDrawBytes = HAL_LCD_listBytes;
+    LCDDrawRun(STATUSROW1, 0, row1, sizeof(row1));
+    LCDDrawRun(STATUSROW2, 0, row2, len2);
+    HAL_LCD_waitQueue();
+    statusDrawCycles = CycleCount() - start;
+    statusDrawBytes = HAL_LCD_listBytes - statusDrawBytes;
+}
+
+void printHotPathsUART();
+void printSchedulerUART();
 
-    one = charCounter / 1000;//calculations to extract each digit
-    two = charCounter / 100 % 10;
-    three = charCounter /10 % 10;
-    four = charCounter % 10;
+void printProfileUART()//report the status draw times in MCLK cycles
+{
+    LCDProfileStatusDraw();
+    UARTPutString("\r\nstatus draw: per char ");
+    UARTPutNumber(statusDrawCharCycles);
+    UARTPutString(" cycles, per run ");
+    UARTPutNumber(statusDrawCycles);
+    UARTPutString(" cycles\r\n");
+    UARTPutString("SPI busy ");//share of the run draw the bus was shifting bytes
+    UARTPutNumber((uint64_t)statusDrawBytes * 8 * (CYCLES_PER_MS * 1000) / HAL_LCD_spiClock * 100 / statusDrawCycles);
+    UARTPutString("% for ");
+    UARTPutNumber(statusDrawBytes);
+    UARTPutString(" bytes\r\n");
+    UARTPutString("display list: max depth ");
+    UARTPutNumber(HAL_LCD_listMaxDepth);
+    UARTPutString(" of ");
+    UARTPutNumber(LCD_LIST_SIZE);
+    UARTPutString(", full ");
+    UARTPutNumber(HAL_LCD_listFullWaits);
+    UARTPutString(" times\r\n");
+    UARTPutString("boot: ");
+    UARTPutNumber(bootCycles / (CYCLES_PER_MS / 1000));
+    UARTPutString(" us\r\n");
+    UARTPutString("image: ");
+    UARTPutNumber(imagePixels);
+    UARTPutString(" px from ");
+    UARTPutNumber(imageBytes);
+    UARTPutString(" bytes in ");
+    UARTPutNumber(imageCycles);
+    UARTPutString(" cycles, ");
+    UARTPutNumber(imageCycles ? (uint32_t)((uint64_t)imagePixels * CYCLES_PER_MS * 1000 / imageCycles) : 0);
+    UARTPutString(" px/s, rx dropped ");
+    UARTPutNumber(rxOverflows);
+    UARTPutString("\r\ncrc32 ");
+    UARTPutString(crcHardware ? "hw" : "sw");
+    UARTPutString(", 256 bytes hw ");
+    UARTPutNumber(crcHardwareCycles);
+    UARTPutString(" sw ");
+    UARTPutNumber(crcSoftwareCycles);
+    UARTPutString(" cycles, frames ok ");
+    UARTPutNumber(framesGood);
+    UARTPutString(" bad ");
+    UARTPutNumber(framesBad);
+#if SETTINGS_STORE
+    UARTPutString("\r\nsettings: sector ");
+    UARTPutNumber(settingsSector);
+    UARTPutString(" slot ");
+    UARTPutNumber(settingsNext);
+    UARTPutString(", ");
+    UARTPutNumber(settingsSaves);
+    UARTPutString(" saves since boot\r\n");
+#else
+    UARTPutString("\r\nsettings: not kept, SETTINGS_STORE is off\r\n");
+#endif
+    printHotPathsUART();
+    printSchedulerUART();
+}
 
-    UARTPutChar(one + '0');//print each digit as char
-    UARTPutChar(two + '0');
-    UARTPutChar(three + '0');
-    UARTPutChar(four + '0');
+void printMessageUART()//same status as the LCD, on one line
+{
+    char row1[16], row2[2 + MAXCOUNTERDIGITS];
+    int len2, i;
+
+    buildStatusRow1(row1);
+    len2 = buildStatusRow2(row2);
+    for (i = 0; i < 7; i++)//"bd 9600"
+        UARTPutChar(row1[i]);
+    for (i = 8; i < 16; i++)//" fg7 bg4"
+        UARTPutChar(row1[i]);
+    UARTPutChar(' ');
+    UARTPutChar('n');
+    for (i = COUNTERCOL; i < len2; i++)
+        UARTPutChar(row2[i]);
 }
 
 void checkButton2Status(bool *button, bool *prev_button, bool *prev_buttonDebounce, bool *buttonDebounce)
@@ -612,183 +1658,1871 @@ void checkButton2Status(bool *button, bool *prev_button, bool *prev_buttonDeboun
 
     *buttonDebounce = BounceFSM(button);
 
-    if (*buttonDebounce & !(*prev_buttonDebounce))//if button 2 pressed
+    static gestureFSM_t s2Gesture;
+    gesture_t gesture = ButtonGesture(&s2Gesture, *buttonDebounce, 0);//debounced already
+
+    if (gesture == gestureLong)//held, page towards newer scrollback
+    {
+        LCDPageHistory(-1);
+    }
+    else if (gesture == gestureShort)//button 2 pressed, acted on at release so holding it only pages
     {
         baudRate += 1; //increment baud rate by 1
         if (baudRate == 4)//if max baud rate
         {
             baudRate = baud9600;//go back to 9600
         }
+        baudAuto = false;
         UARTSetBaud();//set baud rate
+        LCDUpdateStatusField(0, 8);//baud field only
     }
 }
 
-void parseCommand(uint8_t c)
+//------------------------------------------
+// Command parser
+//
+// Commands start with '#', followed by an opcode of one or more characters
+// and an optional argument. Each entry of commandTable is one command:
+//   argNone   no argument                  #p
+//   argDigit  one decimal digit <= argMax  #f7
+//   argDec    decimal number <= argMax, ended by ';' or any other character
+//   argHex6   exactly 6 hex digits         #fcFF8000
+// "##" prints a single '#'. Anything that does not match a command is printed
+// as it was typed. The table is kept sorted by opcode, so the entries that
+// still match the typed opcode are always next to each other. The first
+// opcode character is looked up in commandIndex, and each byte after it
+// only narrows down the entries that share that character (two at most in
+// this table), so the work per byte doesn't grow with the table.
+// Commands that change the whole board only work from the console, on the
+// other panes they are printed like any other text.
+
+typedef struct command {
+    const char *opcode;
+    argType_t argType;
+    uint32_t argMax;
+    void (*handler)(uint32_t arg);
+    bool anyPane;//false for console only
+} command_t;
+
+void emitText(const uint8_t *text, int len)//write to LCD and UART accordingly
 {
-    switch(presentState)
+    int i;
+    for (i = 0; i < len; i++)
     {
-    case idle:
-        if (c == '#')//if c is #, potential command
-        {
-            presentState = command;
-            previousChar = c;
-        }
-        else//write to LCD and UART accordingly
-        {
-            write2LCD(c);
-            UARTPutChar(c);
-        }
-        break;
+        write2LCD(text[i]);
+        if (term != &terms[CONSOLE])//each pane echoes on its own port
+            PanePutChar(term->port, text[i]);
+        else if (uartEcho)
+            UARTPutChar(text[i]);
+    }
+}
 
-    case command:
-        if (c == 'f')//potential fg command
-        {
-            presentState = commandF;
-        }
-        else if (c == 'b')//potential bg command
-        {
-            presentState = commandB;
-        }
-        else //not a valid command, print what characters says
-        {
-            if (c == ' ')
-           {
-               presentState = idle;
-               break;
-           }
-           write2LCD('#');
-           UARTPutChar('#');
-           write2LCD(c);
-           UARTPutChar(c);
-           presentState = idle;
-        }
-        break;
+void cmdLiteral(uint32_t arg) { (void)arg; emitText((const uint8_t *)"#", 1); }
+void cmdNop(uint32_t arg) { (void)arg; }//"# " is dropped, as it always was
 
-    case commandF:
-        if (c >= '0' && c <= '7')//if valid enum number
-        {
-            fg = c - '0';
-            LCDSetFgColor();//set fg color
-            presentState = idle;//go back to idle
-        }
-        else//not a real command, print out every character
-        {
-            write2LCD('#');
-            UARTPutChar('#');
-            previousChar = 'f';
-            write2LCD(previousChar);
-            UARTPutChar(previousChar);
-            write2LCD(c);
-            UARTPutChar(c);
-            presentState = idle;
-        }
-        break;
+void cmdSetFg(uint32_t arg)
+{
+    term->fg = (color_t)arg;
+    LCDSetFgColor();//set fg color
+    if (term == &terms[CONSOLE])//the status row shows the console colors
+        LCDUpdateStatusField(9, 3);
+}
 
-    case commandB:
-        if (c >= '0' && c <= '7')//if valid enum number
-        {
-            bg = c - '0';
-            LCDSetBgColor();//set bg color
-            presentState = idle;
-        }
-        else//write normally with every character
-        {
-            write2LCD('#');
-            UARTPutChar('#');
-            previousChar = 'b';
-            write2LCD(previousChar);
-            UARTPutChar(previousChar);
-            write2LCD(c);
-            UARTPutChar(c);
-            presentState = idle;
-        }
-        break;
-    }
+void cmdSetBg(uint32_t arg)
+{
+    term->bg = (color_t)arg;
+    LCDSetBgColor();//set bg color
+    if (term == &terms[CONSOLE])
+        LCDUpdateStatusField(13, 3);
 }
 
-void InitColorLED()//initalize booster board LED
+void cmdSetFgRGB(uint32_t arg)//translated once here, drawing just uses the pixel value
 {
-    GPIO_setAsOutputPin    (GPIO_PORT_P2,    GPIO_PIN6);   // color LED red on sensor board
-    GPIO_setAsOutputPin    (GPIO_PORT_P2,    GPIO_PIN4);   // color LED green on sensor board
-    GPIO_setAsOutputPin    (GPIO_PORT_P5,    GPIO_PIN6);   // color LED blue on sensor board
+    LCDRenderFrame();//text typed in the old custom color is drawn in it
+    term->customFgPixel = RGB565_SWAPPED(arg);
+    cmdSetFg(custom);
+}
 
-    GPIO_setOutputLowOnPin (GPIO_PORT_P2,    GPIO_PIN6);
-    GPIO_setOutputLowOnPin (GPIO_PORT_P2,    GPIO_PIN4);
-    GPIO_setOutputLowOnPin (GPIO_PORT_P5,    GPIO_PIN6);
+void cmdSetBgRGB(uint32_t arg)
+{
+    LCDRenderFrame();
+    term->customBgPixel = RGB565_SWAPPED(arg);
+    cmdSetBg(custom);
 }
 
-void LEDchange(uint8_t character)
+void cmdTermMode(uint32_t arg)//0 is the 16x8 grid, 1 is the dense 21x16 grid
 {
-    Init200msTimer();//init timers and color LEDS
-    InitColorLED();
+    LCDSetTermMode((termMode_t)arg);
+    printMessageLCD();//status rows on the new grid
+}
 
-    if (character == '#')//hash character, white LED
-    {
-        color = white;
-        Timer200msStartOneShot();//start timer
-        ColorLEDSet(color);
-    }
-    else if (character >= '0' && character <= '9')//number, red LED
-    {
-        color = red;
-        Timer200msStartOneShot();//start timer
-        ColorLEDSet(color);
-    }
-    else if (character >= 'A' && character <= 'Z' || character >= 'a' && character <= 'z')//letter, blue LED
+void cmdBaud(uint32_t arg)//same UARTBaudRate_t numbers as S2 cycles through
+{
+    baudRate = (UARTBaudRate_t)arg;
+    baudAuto = false;
+    UARTSetBaud();
+    LCDUpdateStatusField(0, 8);
+}
+
+void cmdClear(uint32_t arg) { (void)arg; LCDClearText(); }
+void cmdImage(uint32_t arg);
+void cmdQoi(uint32_t arg);
+void cmdFramed(uint32_t arg);
+void cmdErrors(uint32_t arg);
+void cmdBenchmark(uint32_t arg);
+void cmdXonXoff(uint32_t arg) { xonXoff = arg; }
+void cmdScroll(uint32_t arg) { LCDShowHistory(arg); }//#s<n>; shows n lines back, #s0; is live
+void cmdProfile(uint32_t arg) { (void)arg; printProfileUART(); }
+void cmdFrameRate(uint32_t arg);
+
+const command_t commandTable[] = {//sorted by opcode
+    {" ",  argNone,  0,        cmdNop,       true},
+    {"#",  argNone,  0,        cmdLiteral,   true},
+    {"a",  argNone,  0,        cmdAutoBaud,  false},
+    {"b",  argDigit, 7,        cmdSetBg,     true},
+    {"bc", argHex6,  0xFFFFFF, cmdSetBgRGB,  true},
+    {"e",  argNone,  0,        cmdErrors,    false},
+    {"f",  argDigit, 7,        cmdSetFg,     true},
+    {"fc", argHex6,  0xFFFFFF, cmdSetFgRGB,  true},
+    {"i",  argNone,  0,        cmdImage,     false},
+    {"l",  argDigit, 2,        cmdBenchmark, false},
+    {"m",  argDigit, 1,        cmdTermMode,  false},
+    {"p",  argNone,  0,        cmdProfile,   false},
+    {"q",  argNone,  0,        cmdQoi,       false},
+    {"r",  argDec,   MAXFRAMERATE, cmdFrameRate, false},
+    {"s",  argDec,   SCROLLBACK_LINES, cmdScroll, false},
+    {"t",  argDigit, NUMPORTS, cmdPanes,     false},
+    {"u",  argDigit, 3,        cmdBaud,      false},
+    {"w",  argDigit, 1,        cmdXonXoff,   false},
+    {"x",  argNone,  0,        cmdClear,     true},
+    {"y",  argDigit, 1,        cmdFramed,    false},
+};
+#define NUMCOMMANDS ((int)(sizeof(commandTable) / sizeof(commandTable[0])))
+#define OPCODECHARS 128 //first opcode characters are ASCII
+
+//first and last commandTable entry whose opcode starts with each character,
+//first > last if none does
+static int8_t commandFirst[OPCODECHARS], commandLast[OPCODECHARS];
+
+void InitCommands() {//index commandTable by the first opcode character
+    int i, c;
+
+    for (c = 0; c < OPCODECHARS; c++)
     {
-        color = blue;
-        Timer200msStartOneShot();
-        ColorLEDSet(color);//change LED
+        commandFirst[c] = 0;
+        commandLast[c] = -1;
     }
-    else //none of the above, green LED
+    for (i = NUMCOMMANDS - 1; i >= 0; i--)
     {
-        color = green;
-        Timer200msStartOneShot();
-        ColorLEDSet(color);
+        c = commandTable[i].opcode[0];
+        commandFirst[c] = i;
+        if (commandLast[c] < 0)
+            commandLast[c] = i;
     }
 }
 
-//-----------------------------------------------------------------------
+int hexDigitValue(uint8_t c)//-1 if c is not a hex digit
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;//lower case
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
 
-int main(void) {
-    uint8_t c;
+void parseMismatch()//not a command after all, print what was typed
+{
+    emitText(term->commandText, term->commandLen);
+    term->presentState = idle;
+}
 
-    WDT_A_hold(WDT_A_BASE);
+void parseDispatch()
+{
+    if (!term->matched->anyPane && term != &terms[CONSOLE])
+    {
+        parseMismatch();
+        return;
+    }
+    term->presentState = idle;
+    term->matched->handler(term->argValue);
+}
 
-    InitGraphics();//all inits
-    InitUART();
-    InitRedLED();
-    InitButtonS1();
-    InitButtonS2();
-    InitColorLED();
-    Init200msTimer();
-    InitTimerDebounce();
+void parseStartArgument()
+{
+    term->argValue = 0;
+    term->argDigits = 0;
+    if (term->matched->argType == argNone)
+        parseDispatch();
+    else
+        term->presentState = argument;
+}
 
-    bool buttonDebounce = false, prev_buttonDebounce;
-    bool button = false, prev_button;//init variables
+bool parseOpcodeByte(uint8_t c)//narrow the matching range, false if c is not part of the opcode
+{
+    int first = -1, last = -1, i;
 
-    while (1)
+    if (term->opcodeLen == 0)//first character, straight from the index
     {
-        if (Timer200msExpiredOneShot())//if timer expired
+        if (c < OPCODECHARS && commandFirst[c] <= commandLast[c])
         {
-            ColorLEDSet(black);//turn LED off
+            first = commandFirst[c];
+            last = commandLast[c];
         }
+    }
+    else
+    {
+        for (i = term->firstMatch; i <= term->lastMatch; i++)
+        {
+            if (c != 0 && commandTable[i].opcode[term->opcodeLen] == c)
+            {
+                if (first < 0)
+                    first = i;
+                last = i;
+            }
+        }
+    }
+    if (first < 0)
+        return false;
+
+    term->firstMatch = first;
+    term->lastMatch = last;
+    term->opcodeLen++;
+    term->matched = (commandTable[first].opcode[term->opcodeLen] == 0) ? &commandTable[first] : 0;
+    if (term->matched && first == last)//nothing longer can match, the opcode is complete
+        parseStartArgument();
+    return true;
+}
+
+bool parseArgumentByte(uint8_t c)//false if c ends the argument without being part of it
+{
+    int digit = (term->matched->argType == argHex6) ? hexDigitValue(c) : (c >= '0' && c <= '9' ? c - '0' : -1);
 
-        if(UARTHasChar())//if char available on UART
+    if (digit < 0)
+    {
+        if (term->matched->argType == argDec && term->argDigits > 0)//a number ends at the first non-digit
         {
-            c = UARTGetChar();//get char
-            charCounter++;//increment
-            LEDchange(c);//change LED on booster
-            parseCommand(c);//send char to parse
+            parseDispatch();
+            return c == ';';//';' just ends the number, anything else is looked at again
         }
+        parseMismatch();
+        return true;
+    }
+
+    term->argValue = (term->matched->argType == argHex6) ? (term->argValue << 4) | digit : term->argValue * 10 + digit;
+    term->argDigits++;
+    if (term->argValue > term->matched->argMax)
+        parseMismatch();
+    else if ((term->matched->argType == argDigit && term->argDigits == 1) || (term->matched->argType == argHex6 && term->argDigits == 6))
+        parseDispatch();
+    return true;
+}
+
+bool parseCommandByte(uint8_t c)//one byte after the '#', false if c has to be looked at again
+{
+    if (term->commandLen < MAXCOMMANDLEN)
+        term->commandText[term->commandLen++] = c;
+
+    if (term->presentState == argument)
+        return parseArgumentByte(c);
+
+    if (parseOpcodeByte(c))
+        return true;
+    if (term->matched)//opcode complete, c starts its argument
+    {
+        term->commandLen--;
+        parseStartArgument();
+        return false;
+    }
+    parseMismatch();
+    return true;
+}
+
+//------------------------------------------
+// ANSI escape sequences
+//
+// A subset of VT100/ANSI, so host tools can place text instead of only
+// appending it. Rows count from 1 at the top of the pane, rows outside it
+// can't be addressed. Sequences are not echoed back.
+//   ESC[r;cH, ESC[r;cf  cursor position         ESC[nA/B/C/D  cursor up/down/right/left
+//   ESC[nK              erase in line (0,1,2)   ESC[nJ        erase in display (0,1,2)
+//   ESC[...m            0 reset, 30-37 fg, 40-47 bg, 39/49 default, 90-97/100-107 as 30-37/40-47
+// The defaults are the colors the pane starts out in, white on paneBg.
+//   ESC[s, ESC 7        save cursor             ESC[u, ESC 8  restore cursor
+// The SGR color numbers are in the same order as color_t.
+
+int ansiParam(int i, int defaultValue)//parameter i, or the default if it was left out or 0
+{
+    return (i < term->ansiCount && term->ansiParams[i] != 0) ? term->ansiParams[i] : defaultValue;
+}
+
+void ansiMoveTo(int row, int col)//0 based row of the pane and column, clamped to the pane
+{
+    if (row < 0)
+        row = 0;
+    if (row > term->rows - 1)
+        row = term->rows - 1;
+    if (col < 0)
+        col = 0;
+    if (col > termCols - 1)
+        col = termCols - 1;
+    term->rowNum = term->top + row;
+    term->colNum = col;
+}
 
-        checkButton2Status(&button, &prev_button, &prev_buttonDebounce, &buttonDebounce);//if button is pressed change baud rate
+void ansiSetColors()//SGR, applied in order like a real terminal
+{
+    color_t newFg = term->fg, newBg = term->bg;
+    int i;
 
-        if (ButtonS1Pressed())//if button 1 pressed
+    if (term->ansiCount == 0)//ESC[m is a reset
+        term->ansiParams[term->ansiCount++] = 0;
+    for (i = 0; i < term->ansiCount && i < MAXANSIPARAMS; i++)
+    {
+        int p = term->ansiParams[i];
+        if (p == 0)
         {
-            LCDClearDisplay();//clear display
-            printMessageLCD();//print status message on LCD
-            printMessageUART();//also print on UART
+            newFg = term->defaultFg;
+            newBg = term->defaultBg;
         }
+        else if (p >= 30 && p <= 37)
+            newFg = (color_t)(p - 30);
+        else if (p >= 90 && p <= 97)
+            newFg = (color_t)(p - 90);
+        else if (p == 39)
+            newFg = term->defaultFg;
+        else if (p >= 40 && p <= 47)
+            newBg = (color_t)(p - 40);
+        else if (p >= 100 && p <= 107)
+            newBg = (color_t)(p - 100);
+        else if (p == 49)
+            newBg = term->defaultBg;
     }
+    if (newFg != term->fg)//the status row only changes when the color does
+        cmdSetFg(newFg);
+    if (newBg != term->bg)
+        cmdSetBg(newBg);
+}
+
+void ansiExecute(uint8_t final)
+{
+    int row = term->rowNum - term->top;
+    int mode = (term->ansiCount > 0) ? term->ansiParams[0] : 0;
+    int r;
+
+    switch (final)
+    {
+    case 'H':
+    case 'f':
+        ansiMoveTo(ansiParam(0, 1) - 1, ansiParam(1, 1) - 1);
+        break;
+    case 'A':
+        ansiMoveTo(row - ansiParam(0, 1), term->colNum);
+        break;
+    case 'B':
+        ansiMoveTo(row + ansiParam(0, 1), term->colNum);
+        break;
+    case 'C':
+        ansiMoveTo(row, term->colNum + ansiParam(0, 1));
+        break;
+    case 'D':
+        ansiMoveTo(row, term->colNum - ansiParam(0, 1));
+        break;
+    case 'K':
+        if (mode == 0)//cursor to end of line
+            LCDEraseCells(term->rowNum, term->colNum, termCols - term->colNum);
+        else if (mode == 1)//start of line to cursor
+            LCDEraseCells(term->rowNum, 0, term->colNum + 1);
+        else if (mode == 2)
+            LCDEraseCells(term->rowNum, 0, termCols);
+        break;
+    case 'J':
+        if (mode == 0)//cursor to end of screen
+        {
+            LCDEraseCells(term->rowNum, term->colNum, termCols - term->colNum);
+            for (r = term->rowNum + 1; r < term->top + term->rows; r++)
+                LCDEraseCells(r, 0, termCols);
+        }
+        else if (mode == 1)//start of screen to cursor
+        {
+            for (r = term->top; r < term->rowNum; r++)
+                LCDEraseCells(r, 0, termCols);
+            LCDEraseCells(term->rowNum, 0, term->colNum + 1);
+        }
+        else if (mode == 2)//whole pane, the cursor stays where it is
+        {
+            int col = term->colNum;
+            r = term->rowNum;
+            LCDClearText();
+            term->rowNum = r;
+            term->colNum = col;
+        }
+        break;
+    case 'm':
+        ansiSetColors();
+        break;
+    case 's':
+        term->savedRow = term->rowNum;
+        term->savedCol = term->colNum;
+        break;
+    case 'u':
+        term->rowNum = term->savedRow;
+        term->colNum = term->savedCol;
+        break;
+    }
+}
+
+bool parseEscapeByte(uint8_t c)//one byte after ESC, always used up
+{
+    if (term->presentState == escape)
+    {
+        term->presentState = idle;
+        if (c == '[')
+        {
+            term->presentState = csi;
+            term->ansiCount = 0;
+        }
+        else if (c == '7')
+        {
+            term->savedRow = term->rowNum;
+            term->savedCol = term->colNum;
+        }
+        else if (c == '8')
+        {
+            term->rowNum = term->savedRow;
+            term->colNum = term->savedCol;
+        }
+        return true;//anything else is an escape we don't support, dropped
+    }
+
+    if (c >= '0' && c <= '9')
+    {
+        if (term->ansiCount == 0)
+            term->ansiParams[term->ansiCount++] = 0;
+        if (term->ansiCount <= MAXANSIPARAMS && term->ansiParams[term->ansiCount - 1] < 1000)
+            term->ansiParams[term->ansiCount - 1] = term->ansiParams[term->ansiCount - 1] * 10 + (c - '0');
+    }
+    else if (c == ';')
+    {
+        if (term->ansiCount == 0)//leading ';' means the first parameter was left out
+            term->ansiParams[term->ansiCount++] = 0;
+        if (term->ansiCount < MAXANSIPARAMS)
+            term->ansiParams[term->ansiCount] = 0;
+        term->ansiCount++;
+    }
+    else if (c >= 0x40 && c <= 0x7E)//final byte
+    {
+        if (term->ansiCount > MAXANSIPARAMS)
+            term->ansiCount = MAXANSIPARAMS;
+        term->presentState = idle;
+        ansiExecute(c);
+    }
+    else if (c < 0x20 || c > 0x7E)//not part of a sequence, give up on it
+        term->presentState = idle;
+    return true;//intermediate and private bytes like '?' are skipped
+}
+
+//------------------------------------------
+// Image upload
+//
+// #i is followed by four raw bytes x, y, w, h and then w*h RGB565 pixels,
+// high byte first. The pixels go into the panel's RAMWR stream as they are
+// received, without a framebuffer. Nothing inside the upload is taken as
+// text or a command, so the pixel data may hold any byte. A window outside
+// the panel cancels the upload and what follows is treated as text.
+//
+// The status rows and scrollback may draw while an upload is under way.
+// When they do, the window is set again from the next pixel. A partial
+// row gets a window of its own.
+
+static uint8_t imageHeader[16];//big enough for the #q header too
+static int imageHeaderLen;
+static int imageX, imageY, imageW, imageH;
+static uint32_t imageBytesLeft;//not received yet
+static uint32_t imagePixel;//next pixel to write, row by row
+static uint32_t imageWindowEnd;//pixel the current window runs out at
+static uint8_t imageHalf;//first byte of a pixel whose second byte is still to come
+static bool imageHasHalf;
+static uint32_t imageStartCycles;
+
+void cmdImage(uint32_t arg)
+{
+    (void)arg;
+    imageHeaderLen = 0;
+    imageBytes = 0;
+    term->presentState = imageHead;
+}
+
+void imageWritePixels(const uint8_t *data, uint32_t count)//count pixels, 2 bytes each
+{
+    uint32_t chunk;
+    int px, py;
+
+    while (count > 0)
+    {
+        if (!imageWindowSet || imagePixel == imageWindowEnd)
+        {
+            px = imagePixel % imageW;
+            py = imagePixel / imageW;
+            if (px == 0)//whole rows from here to the bottom
+            {
+                Crystalfontz128x128_SetDrawFrame(imageX, imageY + py, imageX + imageW - 1, imageY + imageH - 1);
+                imageWindowEnd = imageW * imageH;
+            }
+            else//finish the row first
+            {
+                Crystalfontz128x128_SetDrawFrame(imageX + px, imageY + py, imageX + imageW - 1, imageY + py);
+                imageWindowEnd = imagePixel + imageW - px;
+            }
+            HAL_LCD_writeCommand(CM_RAMWR);
+            imageWindowSet = true;
+        }
+        chunk = imageWindowEnd - imagePixel;
+        if (chunk > count)
+            chunk = count;
+        HAL_LCD_writeDataBuffer(data, chunk * 2);
+        data += chunk * 2;
+        count -= chunk;
+        imagePixel += chunk;
+    }
+}
+
+bool imageStart(int x, int y, int w, int h)//false if the window is not on the panel
+{
+    if (w == 0 || h == 0 || x + w > LCD_HORIZONTAL_MAX || y + h > LCD_VERTICAL_MAX)
+        return false;
+    LCDRenderFrame();//text still to be drawn must not land on the image
+    imageX = x;
+    imageY = y;
+    imageW = w;
+    imageH = h;
+    imagePixel = 0;
+    imageWindowSet = false;
+    imageStartCycles = CycleCount();
+    return true;
+}
+
+void imageFinish()
+{
+    imageCycles = CycleCount() - imageStartCycles;
+    imagePixels = (uint32_t)imageW * imageH;
+    term->presentState = idle;
+}
+
+int parseQoiBytes(const uint8_t *buf, int len);
+
+int parseImageBytes(const uint8_t *buf, int len)//returns how many bytes belonged to the upload
+{
+    int used = 0;
+    uint32_t count;
+
+    if (term->presentState >= qoiHead)
+    {
+        used = parseQoiBytes(buf, len);
+        imageBytes += used;
+        return used;
+    }
+
+    if (term->presentState == imageHead)
+    {
+        while (used < len && imageHeaderLen < 4)
+            imageHeader[imageHeaderLen++] = buf[used++];
+        if (imageHeaderLen < 4)
+            return used;
+
+        if (!imageStart(imageHeader[0], imageHeader[1], imageHeader[2], imageHeader[3]))
+        {
+            term->presentState = idle;
+            return used;
+        }
+        imageBytesLeft = (uint32_t)imageW * imageH * 2;
+        imageHasHalf = false;
+        term->presentState = imageData;
+    }
+
+    while (used < len && imageBytesLeft > 0)
+    {
+        if (imageHasHalf)//pair it with its second byte
+        {
+            uint8_t pixel[2] = {imageHalf, buf[used++]};
+            imageHasHalf = false;
+            imageBytesLeft--;
+            imageWritePixels(pixel, 1);
+            continue;
+        }
+        count = len - used;
+        if (count > imageBytesLeft)
+            count = imageBytesLeft;
+        if (count == 1)//half a pixel, kept until the rest arrives
+        {
+            imageHalf = buf[used++];
+            imageHasHalf = true;
+            imageBytesLeft--;
+            continue;
+        }
+        count &= ~1u;
+        imageBytesLeft -= count;
+        imageWritePixels(buf + used, count / 2);
+        used += count;
+    }
+
+    imageBytes += used;
+    if (imageBytesLeft == 0)
+        imageFinish();
+    return used;
+}
+
+//------------------------------------------
+// QOI image upload
+//
+// #q is followed by two raw bytes x, y and then a whole .qoi file, as any
+// QOI encoder writes it: the 14 byte header, the chunks and the 8 byte end
+// marker. Width and height come from the header and must fit on the panel
+// from x, y. Pixels are decoded into qoiLine and written through the same
+// window handling as #i, so no framebuffer is needed. Alpha is decoded,
+// because later chunks depend on it, but it is not drawn.
+// tools/qoi_encode.py encodes a PPM or PAM and sends it; test/test_qoi.c
+// gives the ratio and frame time on sample images at each baud rate.
+
+#define QOIHEADERLEN 16 //x, y and the 14 byte file header
+#define QOIENDLEN 8
+#define QOILINEPIXELS 32 //decoded pixels held before they go to the panel
+
+static uint8_t qoiIndex[64][4];//recently seen pixels, RGBA
+static uint8_t qoiPx[4];//previous pixel
+static uint8_t qoiChunk[5];
+static int qoiChunkLen, qoiChunkNeed;
+static int qoiEndLeft;//end marker bytes still to skip
+static uint32_t qoiPixelsLeft;
+static uint16_t qoiLine[QOILINEPIXELS];
+static int qoiLineLen;
+
+void cmdQoi(uint32_t arg)
+{
+    (void)arg;
+    imageHeaderLen = 0;
+    imageBytes = 0;
+    term->presentState = qoiHead;
+}
+
+void qoiFlushLine()
+{
+    imageWritePixels((const uint8_t *)qoiLine, qoiLineLen);
+    qoiLineLen = 0;
+}
+
+//count copies of qoiPx, the run decoder, runs from SRAM
+RAMFUNC_TWIN(void, qoiEmit, (int count),
+    uint16_t pixel = RGB565_SWAPPED(((uint32_t)qoiPx[0] << 16) | (qoiPx[1] << 8) | qoiPx[2]);
+    memcpy(qoiIndex[(qoiPx[0] * 3 + qoiPx[1] * 5 + qoiPx[2] * 7 + qoiPx[3] * 11) % 64], qoiPx, 4);
+    if ((uint32_t)count > qoiPixelsLeft)//a broken stream can't write past the window
+        count = qoiPixelsLeft;
+    qoiPixelsLeft -= count;
+    while (count--)
+    {
+        qoiLine[qoiLineLen++] = pixel;
+        if (qoiLineLen == QOILINEPIXELS)
+            qoiFlushLine();
+    }
+)
+
+void qoiDecodeChunk()
+{
+    uint8_t tag = qoiChunk[0];
+    int vg;
+
+    if (tag == 0xFE || tag == 0xFF)//QOI_OP_RGB, QOI_OP_RGBA
+    {
+        memcpy(qoiPx, qoiChunk + 1, tag == 0xFF ? 4 : 3);
+        qoiEmit(1);
+    }
+    else if ((tag >> 6) == 0)//QOI_OP_INDEX
+    {
+        memcpy(qoiPx, qoiIndex[tag], 4);
+        qoiEmit(1);
+    }
+    else if ((tag >> 6) == 1)//QOI_OP_DIFF
+    {
+        qoiPx[0] += ((tag >> 4) & 3) - 2;
+        qoiPx[1] += ((tag >> 2) & 3) - 2;
+        qoiPx[2] += (tag & 3) - 2;
+        qoiEmit(1);
+    }
+    else if ((tag >> 6) == 2)//QOI_OP_LUMA
+    {
+        vg = (tag & 0x3F) - 32;
+        qoiPx[0] += vg - 8 + (qoiChunk[1] >> 4);
+        qoiPx[1] += vg;
+        qoiPx[2] += vg - 8 + (qoiChunk[1] & 0x0F);
+        qoiEmit(1);
+    }
+    else//QOI_OP_RUN
+    {
+        qoiEmit((tag & 0x3F) + 1);
+    }
+}
+
+int parseQoiBytes(const uint8_t *buf, int len)//returns how many bytes belonged to the upload
+{
+    int used = 0;
+    uint8_t c;
+
+    if (term->presentState == qoiHead)
+    {
+        while (used < len && imageHeaderLen < QOIHEADERLEN)
+            imageHeader[imageHeaderLen++] = buf[used++];
+        if (imageHeaderLen < QOIHEADERLEN)
+            return used;
+
+        //magic "qoif", then width and height as big endian 32 bit numbers
+        if (memcmp(imageHeader + 2, "qoif", 4) != 0 ||
+            imageHeader[6] || imageHeader[7] || imageHeader[8] ||
+            imageHeader[10] || imageHeader[11] || imageHeader[12] ||
+            !imageStart(imageHeader[0], imageHeader[1], imageHeader[9], imageHeader[13]))
+        {
+            term->presentState = idle;
+            return used;
+        }
+        memset(qoiIndex, 0, sizeof(qoiIndex));
+        qoiPx[0] = qoiPx[1] = qoiPx[2] = 0;
+        qoiPx[3] = 255;
+        qoiChunkLen = 0;
+        qoiLineLen = 0;
+        qoiEndLeft = QOIENDLEN;
+        qoiPixelsLeft = (uint32_t)imageW * imageH;
+        term->presentState = qoiData;
+    }
+
+    while (used < len && qoiPixelsLeft > 0)
+    {
+        c = buf[used++];
+        if (qoiChunkLen == 0)//tag byte, tells how long the chunk is
+            qoiChunkNeed = (c == 0xFF) ? 5 : (c == 0xFE) ? 4 : ((c >> 6) == 2) ? 2 : 1;
+        qoiChunk[qoiChunkLen++] = c;
+        if (qoiChunkLen == qoiChunkNeed)
+        {
+            qoiChunkLen = 0;
+            qoiDecodeChunk();
+        }
+    }
+    if (qoiLineLen > 0)//don't hold decoded pixels back while waiting for more bytes
+        qoiFlushLine();
+
+    while (used < len && qoiPixelsLeft == 0 && qoiEndLeft > 0)
+    {
+        used++;
+        qoiEndLeft--;
+    }
+    if (qoiPixelsLeft == 0 && qoiEndLeft == 0)
+        imageFinish();
+    return used;
+}
+
+//------------------------------------------
+// Framed mode
+//
+// "#y1" switches the UART to SLIP framed binary. Each frame carries
+//   seq, opcode, payload..., CRC32 of the bytes before it (little endian)
+// and every frame is answered with a frame of its own: FRAMEACK or FRAMENAK,
+// the seq, the credit (little endian 16 bit) and the CRC32. A NAKed frame is
+// meant to be sent again.
+//
+// Frames are run in seq order, so a sender can have several out at once.
+// Only the frame after the last one run is run. One up to 127 behind it was
+// run already and is ACKed again, which covers lost ACKs. One ahead of it
+// means a frame in between was lost, and it is NAKed without being run. The
+// sender then goes back to its oldest frame that wasn't ACKed and sends
+// everything from there again. The first frame after #y1 sets the seq.
+// tools/framed_send.py is a sender that keeps to all of this.
+//
+// The credit is the free space in the RX ring when the reply was sent. A
+// sender keeps what it has sent after the answered frame, SLIP escapes
+// included, at or below the last credit it got, and never overruns the ring
+// however slow the drawing is. Bytes already in the ring count twice, so
+// the rule errs on the safe side.
+//   FRAMETEXT  payload goes through the text parser, but nothing is echoed
+//   FRAMEEXIT  back to the text protocol, once the ACK has been sent
+// Text payload keeps its own parser state from frame to frame, so a #i or #q
+// upload can be split over as many frames as it needs.
+//
+// The CRC is the usual CRC-32 (the zlib and Ethernet one). It runs on the
+// CRC32 module, unless that doesn't give the check value for "123456789" at
+// start up, in which case it is computed in software. #p gives the cycles
+// both take on 256 bytes, test/test_crc.c the host figures for comparison.
+
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+#define FRAMEMAX 262 //seq, opcode, 256 bytes of payload and the CRC
+#define FRAMEACK 0x06
+#define FRAMENAK 0x15
+#define FRAMEEXIT 0x00
+#define FRAMETEXT 0x01
+#define CRC32_CHECK 0xCBF43926 //CRC-32 of "123456789"
+
+static uint8_t frameBuf[FRAMEMAX];
+static int frameLen;
+static bool frameEscaped, frameOverflow;
+static int frameLastSeq = -1;//seq of the last frame that was run, -1 for none yet
+static parseState_t frameTextState = idle;//text parser inside the frames
+
+uint32_t crc32Software(const uint8_t *data, int len)
+{
+    static const uint32_t nibbleTable[16] = {//reflected polynomial 0xEDB88320, 4 bits at a time
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ nibbleTable[crc & 0x0F];
+        crc = (crc >> 4) ^ nibbleTable[crc & 0x0F];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+uint32_t crc32Hardware(const uint8_t *data, int len)
+{
+    CRC32_setSeed(0xFFFFFFFF, CRC32_MODE);
+    while (len--)
+        CRC32_set8BitData(*data++, CRC32_MODE);
+    return CRC32_getResultReversed(CRC32_MODE) ^ 0xFFFFFFFF;
+}
+
+uint32_t crc32(const uint8_t *data, int len)
+{
+    return crcHardware ? crc32Hardware(data, len) : crc32Software(data, len);
+}
+
+void InitCRC32() {//use the CRC32 module if it gives the standard result, and time both
+    uint32_t start;
+
+    crcHardware = (crc32Hardware((const uint8_t *)"123456789", 9) == CRC32_CHECK);
+
+    start = CycleCount();
+    crc32Hardware(frameBuf, 256);
+    crcHardwareCycles = CycleCount() - start;
+    start = CycleCount();
+    crc32Software(frameBuf, 256);
+    crcSoftwareCycles = CycleCount() - start;
+}
+
+void slipPutByte(uint8_t c)
+{
+    if (c == SLIP_END)
+    {
+        UARTPutChar(SLIP_ESC);
+        UARTPutChar(SLIP_ESC_END);
+    }
+    else if (c == SLIP_ESC)
+    {
+        UARTPutChar(SLIP_ESC);
+        UARTPutChar(SLIP_ESC_ESC);
+    }
+    else
+        UARTPutChar(c);
+}
+
+void frameReply(uint8_t type, uint8_t seq)
+{
+    uint16_t credit = UARTRxFree();
+    uint8_t reply[8] = {type, seq, credit, credit >> 8};
+    uint32_t crc = crc32(reply, 4);
+    int i;
+
+    reply[4] = crc;
+    reply[5] = crc >> 8;
+    reply[6] = crc >> 16;
+    reply[7] = crc >> 24;
+    UARTPutChar(SLIP_END);//ends whatever noise the host may have seen before
+    for (i = 0; i < (int)sizeof(reply); i++)
+        slipPutByte(reply[i]);
+    UARTPutChar(SLIP_END);
+}
+
+void frameExecute()//a whole frame is in frameBuf
+{
+    uint32_t crc;
+    uint8_t seq;
+
+    if (frameOverflow || frameLen < 6)
+    {
+        framesBad++;
+        frameReply(FRAMENAK, frameLen > 0 ? frameBuf[0] : 0);
+        return;
+    }
+    frameLen -= 4;
+    crc = frameBuf[frameLen] | (frameBuf[frameLen + 1] << 8) |
+          ((uint32_t)frameBuf[frameLen + 2] << 16) | ((uint32_t)frameBuf[frameLen + 3] << 24);
+    seq = frameBuf[0];
+    if (crc != crc32(frameBuf, frameLen))
+    {
+        framesBad++;
+        frameReply(FRAMENAK, seq);
+        return;
+    }
+    framesGood++;
+    if (frameLastSeq >= 0 && seq != (uint8_t)(frameLastSeq + 1))
+    {
+        if ((uint8_t)(frameLastSeq - seq) < 128)//already run, only the ACK got lost
+            frameReply(FRAMEACK, seq);
+        else//out of order, one before it was lost
+            frameReply(FRAMENAK, seq);
+        return;
+    }
+    frameLastSeq = seq;
+
+    if (frameBuf[1] == FRAMETEXT)
+    {
+        term->presentState = frameTextState;
+        parseCommands(frameBuf + 2, frameLen - 2);
+        frameTextState = term->presentState;
+        term->presentState = framed;
+        frameReply(FRAMEACK, seq);
+    }
+    else if (frameBuf[1] == FRAMEEXIT)
+    {
+        frameReply(FRAMEACK, seq);
+        term->presentState = idle;
+        uartEcho = true;
+    }
+    else
+        frameReply(FRAMENAK, seq);
+}
+
+void cmdFramed(uint32_t arg)//#y1 switches to framed mode, #y0 does nothing
+{
+    if (arg == 0)
+        return;
+    term->presentState = framed;
+    uartEcho = false;
+    frameLen = 0;
+    frameEscaped = false;
+    frameOverflow = false;
+    frameLastSeq = -1;
+    frameTextState = idle;
+}
+
+int parseFrameBytes(const uint8_t *buf, int len)//returns how many bytes belonged to framed mode
+{
+    int used = 0;
+    uint8_t c;
+
+    while (used < len && term->presentState == framed)
+    {
+        c = buf[used++];
+        if (c == SLIP_END)
+        {
+            if (frameLen > 0 || frameOverflow)//back to back ENDs are just idle line
+                frameExecute();
+            frameLen = 0;
+            frameEscaped = false;
+            frameOverflow = false;
+            continue;
+        }
+        if (frameEscaped)
+        {
+            frameEscaped = false;
+            c = (c == SLIP_ESC_END) ? SLIP_END : (c == SLIP_ESC_ESC) ? SLIP_ESC : c;
+        }
+        else if (c == SLIP_ESC)
+        {
+            frameEscaped = true;
+            continue;
+        }
+        if (frameLen < FRAMEMAX)
+            frameBuf[frameLen++] = c;
+        else
+            frameOverflow = true;
+    }
+    return used;
+}
+
+//------------------------------------------
+// Settings store
+//
+// Baud rate, console colors, terminal mode, XON/XOFF, the number of panes
+// and the character counter are kept in INFO flash and put back at boot.
+//
+// The records go round the INFO sectors nothing else here uses: bank 1
+// sector 1 (0x203000) and bank 0 sector 0 (0x200000), where the flash
+// mailbox would go. This firmware puts nothing in the mailbox, and a record
+// can't be taken for one, its first byte is SETTINGS_VERSION and not the
+// mailbox start key. The TLV (0x201000) and the BSL (0x202000, .bslArea in
+// msp432p401r.cmd) are never erased. Build with SETTINGS_STORE set to 0
+// (-DSETTINGS_STORE=0) for a board that should boot from the defaults.
+//
+// Each save appends a 32 byte record, two 128 bit flash words, so a sector
+// holds 128 of them. When one sector is full the next one is erased and
+// used, so each erase covers 128 saves. A record has a version, a sequence
+// number and a CRC-32. The sector in use is the one whose first record has
+// the latest sequence number. Records are written in order and an erased
+// slot reads all 0xFF, so a binary search of fixed length finds the first
+// free slot: boot reads the same number of records whatever is saved. Only
+// the newest record can have been cut short by a reset, and then it fails
+// its CRC and the one before it is used.
+//
+// Changes are saved once nothing has changed for SETTINGSQUIET, or at most
+// SETTINGSMAXDELAY after the first unsaved change. The character counter is
+// written along with every record. A change of the counter on its own is
+// only saved on the SETTINGSMAXDELAY path, so steady traffic costs one
+// record a minute, an erase of each sector every four hours.
+
+#if SETTINGS_STORE
+#ifndef SETTINGS_INFO
+#define SETTINGS_INFO 0x00200000 //start of INFO flash
+#endif
+#define SETTINGS_SECTOR_SIZE 4096
+#define SETTINGS_SECTORS 2
+#define SETTINGS_SLOTS ((int)(SETTINGS_SECTOR_SIZE / sizeof(settings_t)))
+#define SETTINGS_VERSION 1
+#define SETTINGS_ERASED 0xFF
+#define SETTINGSQUIET (2000 * CYCLES_PER_MS)
+#define SETTINGSMAXDELAY (60000 * CYCLES_PER_MS)
+
+typedef struct {
+    uint8_t version;//SETTINGS_VERSION, SETTINGS_ERASED in an empty slot
+    uint8_t baud;
+    uint8_t fg, bg;//console colors
+    uint16_t customFg, customBg;
+    uint32_t seq;//counts up with every save
+    uint32_t charCounter;
+    uint8_t termMode, xonXoff;
+    uint8_t panes;//paneCount, erased in records from before panes
+    uint8_t frameRate;//erased in records from before #r
+    uint8_t spare[8];//left erased, room for more settings
+    uint32_t crc;//CRC-32 of everything before it
+} settings_t;
+
+static const struct {
+    uintptr_t addr;
+    uint_fast8_t space;//for FlashCtl_unprotectSector
+    uint32_t mask;
+} settingsSectors[SETTINGS_SECTORS] = {
+    {SETTINGS_INFO + 0x3000, FLASH_INFO_MEMORY_SPACE_BANK1, FLASH_SECTOR1},
+    {SETTINGS_INFO + 0x0000, FLASH_INFO_MEMORY_SPACE_BANK0, FLASH_SECTOR0},
+};
+
+static settings_t settingsSaved, settingsSeen;//last record written, values at the last poll
+static uint32_t settingsCounterSaved;//charCounter in the last record
+static uint32_t settingsChangedAt, settingsDirtyAt;
+static bool settingsDirty = false;//a setting changed since the last save
+static bool settingsCounted = false;//the counter moved since the last save
+
+const settings_t *settingsSlot(int sector, int slot) {
+    return (const settings_t *)settingsSectors[sector].addr + slot;
+}
+
+bool settingsValid(const settings_t *r) {//crc32Software, the CRC module may not be set up yet
+    return r->version == SETTINGS_VERSION &&
+           r->crc == crc32Software((const uint8_t *)r, sizeof(settings_t) - sizeof(r->crc));
+}
+
+bool settingsBlank(const settings_t *r) {//erased, not a record cut short before its first byte
+    const uint8_t *b = (const uint8_t *)r;
+    unsigned i;
+
+    for (i = 0; i < sizeof(settings_t); i++)
+        if (b[i] != SETTINGS_ERASED)
+            return false;
+    return true;
+}
+
+const settings_t *settingsFindLatest() {//also sets where the next record goes
+    int sector, used, step;
+
+    settingsSector = -1;
+    for (sector = 0; sector < SETTINGS_SECTORS; sector++)//the sector in use is the one that started last
+        if (settingsValid(settingsSlot(sector, 0)) && (settingsSector < 0 ||
+            (int32_t)(settingsSlot(sector, 0)->seq - settingsSlot(settingsSector, 0)->seq) > 0))
+            settingsSector = sector;
+    if (settingsSector < 0)//never saved: the first save erases sector 0
+    {
+        settingsSector = SETTINGS_SECTORS - 1;
+        settingsNext = SETTINGS_SLOTS;
+        return 0;
+    }
+
+    used = 0;//slots written, slot 0 is known to be
+    for (step = SETTINGS_SLOTS; step > 0; step /= 2)
+        if (used + step <= SETTINGS_SLOTS && !settingsBlank(settingsSlot(settingsSector, used + step - 1)))
+            used += step;
+    settingsNext = used;
+
+    if (settingsValid(settingsSlot(settingsSector, used - 1)))
+        return settingsSlot(settingsSector, used - 1);
+    return settingsSlot(settingsSector, used - 2);//cut short, used is at least 2 since slot 0 is valid
+}
+
+void settingsCapture(settings_t *r) {//current values, as a record still without counter, seq and CRC
+    memset(r, SETTINGS_ERASED, sizeof(*r));
+    r->version = SETTINGS_VERSION;
+    r->baud = baudRate;
+    r->fg = terms[CONSOLE].fg;
+    r->bg = terms[CONSOLE].bg;
+    r->customFg = terms[CONSOLE].customFgPixel;
+    r->customBg = terms[CONSOLE].customBgPixel;
+    r->termMode = termMode;
+    r->xonXoff = xonXoff;
+    r->panes = paneCount;
+    r->frameRate = frameRate;
+}
+
+bool settingsWrite(const settings_t *values) {
+    settings_t r = *values;
+    bool ok = true;
+
+    if (settingsNext >= SETTINGS_SLOTS)//full, move to the next sector
+    {
+        settingsSector = (settingsSector + 1) % SETTINGS_SECTORS;
+        settingsNext = 0;
+    }
+    r.charCounter = charCounter;
+    r.seq = ++settingsSeq;
+    r.crc = crc32Software((const uint8_t *)&r, sizeof(r) - sizeof(r.crc));
+
+    FlashCtl_unprotectSector(settingsSectors[settingsSector].space, settingsSectors[settingsSector].mask);
+    if (settingsNext == 0)
+        ok = FlashCtl_eraseSector(settingsSectors[settingsSector].addr);
+    if (ok)
+        ok = FlashCtl_programMemory(&r, (void *)settingsSlot(settingsSector, settingsNext), sizeof(r));
+    FlashCtl_protectSector(settingsSectors[settingsSector].space, settingsSectors[settingsSector].mask);
+
+    settingsNext++;//a failed slot is skipped, not written twice
+    settingsSaves++;
+    settingsCounterSaved = r.charCounter;
+    return ok;
+}
+
+void SettingsLoad() {//called before anything is set up from the settings
+    const settings_t *r = settingsFindLatest();
+
+    if (r && r->baud <= baud57600 && r->fg <= custom && r->bg <= custom && r->termMode <= termFixed6x8)
+    {
+        settingsSeq = r->seq;
+        baudRate = (UARTBaudRate_t)r->baud;
+        terms[CONSOLE].fg = (color_t)r->fg;
+        terms[CONSOLE].bg = (color_t)r->bg;
+        terms[CONSOLE].customFgPixel = r->customFg;
+        terms[CONSOLE].customBgPixel = r->customBg;
+        charCounter = r->charCounter;
+        termMode = (termMode_t)r->termMode;
+        xonXoff = r->xonXoff != 0;
+        paneCount = (r->panes >= 1 && r->panes <= NUMPORTS) ? r->panes : 1;
+        frameRate = (r->frameRate <= MAXFRAMERATE) ? r->frameRate : FRAMERATE;
+    }
+    settingsCapture(&settingsSaved);
+    settingsSeen = settingsSaved;
+    settingsCounterSaved = charCounter;
+    settingsDirty = settingsCounted = false;
+}
+
+void SettingsPoll() {//called from the main loop, saves changes in batches
+    settings_t now;
+    uint32_t t = CycleCount();
+    bool quiet, late;
+
+    settingsCapture(&now);
+    if (memcmp(&now, &settingsSeen, sizeof(now)) != 0)
+    {
+        if (!settingsDirty && !settingsCounted)
+            settingsDirtyAt = t;
+        settingsDirty = true;
+        settingsChangedAt = t;
+        settingsSeen = now;
+    }
+    if (charCounter != settingsCounterSaved && !settingsCounted)
+    {
+        if (!settingsDirty)
+            settingsDirtyAt = t;
+        settingsCounted = true;
+    }
+    quiet = settingsDirty && t - settingsChangedAt >= SETTINGSQUIET;
+    late = (settingsDirty || settingsCounted) && t - settingsDirtyAt >= SETTINGSMAXDELAY;
+    if (!quiet && !late)
+        return;
+    settingsDirty = false;
+    //changed and changed back needs no record, and the counter waits for the late one
+    if (memcmp(&now, &settingsSaved, sizeof(now)) != 0 || (late && settingsCounted))
+    {
+        settingsSaved = now;
+        settingsWrite(&now);
+        settingsCounted = false;
+    }
+}
+#else
+void SettingsLoad() {}//no store, the defaults stand
+void SettingsPoll() {}
+#endif
+
+//------------------------------------------
+// Hot paths in SRAM
+//
+// Code that runs for every byte, character or pixel is marked RAMFUNC, so
+// it runs from SRAM and doesn't wait on the flash once MCLK goes up to 48MHz:
+// the SPI write loop, glyph expansion, the QOI run decoder, the UART
+// interrupt and the ring buffer. The RAMFUNC_TWIN ones have a flash copy as
+// well, and #p times both copies on the same work.
+//
+// The GRLIB primitives of the panel driver come built for each orientation,
+// and #p times them against the generic ones, drawing over the status rows.
+
+#define HOTREPS 16
+#define SRAM_CODE_START 0x01000000
+
+uint32_t timeGlyphRow(void (*fn)(uint16_t *, const uint8_t *const *, const uint16_t *, const uint16_t *, int, int))//a whole 21 character run
+{
+    uint16_t row[MAXCOLS * FIXED_CELL_WIDTH], fgs[MAXCOLS], bgs[MAXCOLS];
+    const uint8_t *glyphs[MAXCOLS];
+    uint32_t start;
+    int i;
+
+    for (i = 0; i < MAXCOLS; i++)
+    {
+        glyphs[i] = g_sFontFixed6x8.data + g_sFontFixed6x8.offset['A' + i - ' '] + 2;
+        fgs[i] = colorTable[white];
+        bgs[i] = colorTable[black];
+    }
+    start = CycleCount();
+    for (i = 0; i < FIXED_CELL_HEIGHT; i++)
+        fn(row, glyphs, fgs, bgs, MAXCOLS, i);
+    return CycleCount() - start;
+}
+
+uint32_t timeSpiWrite(void (*fn)(const uint8_t *, uint16_t))//64 bytes into the column just off the right edge
+{
+    static const uint8_t data[64];
+    uint32_t start;
+
+    Crystalfontz128x128_SetDrawFrame(LCD_HORIZONTAL_MAX, 0, LCD_HORIZONTAL_MAX, LCD_VERTICAL_MAX - 1);
+    HAL_LCD_writeCommand(CM_RAMWR);
+    imageWindowSet = false;
+    start = CycleCount();
+    fn(data, sizeof(data));
+    return CycleCount() - start;
+}
+
+uint32_t timeQoiRun(void (*fn)(int))//runs of 31 pixels, short of a line flush
+{
+    uint32_t start, cycles;
+    int i;
+
+    qoiPixelsLeft = HOTREPS * (QOILINEPIXELS - 1);
+    start = CycleCount();
+    for (i = 0; i < HOTREPS; i++)
+    {
+        qoiLineLen = 0;
+        fn(QOILINEPIXELS - 1);
+    }
+    cycles = CycleCount() - start;
+    qoiLineLen = 0;
+    return cycles;
+}
+
+uint32_t timeRing(void (*put)(uint8_t), uint8_t (*get)(void))//HOTREPS bytes in and out
+{
+    uint16_t head = rxHead, tail = rxTail;
+    uint32_t start, cycles;
+    int i;
+
+    if (UARTRxFree() < HOTREPS)
+        return 0;
+    Interrupt_disableInterrupt(INT_EUSCIA0);//the ring is borrowed and put back as it was
+    start = CycleCount();
+    for (i = 0; i < HOTREPS; i++)
+        put(i);
+    for (i = 0; i < HOTREPS; i++)
+        get();
+    cycles = CycleCount() - start;
+    rxHead = head;
+    rxTail = tail;
+    Interrupt_enableInterrupt(INT_EUSCIA0);
+    return cycles;
+}
+
+void hotPathPut(const char *name, uint32_t flash, uint32_t sram)
+{
+    UARTPutString(name);
+    UARTPutString(" flash ");
+    UARTPutNumber(flash);
+    UARTPutString(" sram ");
+    UARTPutNumber(sram);
+    UARTPutString(" cycles\r\n");
+}
+
+const char *primitiveNames[] = {"pixel", "run 1bpp", "run 4bpp", "run 8bpp", "hline", "vline", "rect"};
+#define NUMPRIMITIVES ((int)(sizeof(primitiveNames) / sizeof(primitiveNames[0])))
+
+uint32_t timePrimitive(const Graphics_Display_Functions *funcs, int primitive)//64 pixel runs, 16 pixel vline, 64x16 rect
+{
+    static const uint8_t data[64];
+    static const uint32_t palette[16];
+    const Graphics_Rectangle rect = {0, 0, 63, 15};
+    const Graphics_Display *panel = &g_sCrystalfontz128x128;
+    uint32_t start;
+
+    HAL_LCD_waitQueue();//the text still going out is not counted
+    imageWindowSet = false;
+    start = CycleCount();
+    switch (primitive)
+    {
+    case 0: funcs->pfnPixelDraw(panel, 0, 0, 0); break;
+    case 1: funcs->pfnPixelDrawMultiple(panel, 0, 0, 0, 64, 1, data, palette); break;
+    case 2: funcs->pfnPixelDrawMultiple(panel, 0, 0, 0, 64, 4, data, palette); break;
+    case 3: funcs->pfnPixelDrawMultiple(panel, 0, 0, 0, 64, 8, data, palette); break;
+    case 4: funcs->pfnLineDrawH(panel, 0, 63, 0, 0); break;
+    case 5: funcs->pfnLineDrawV(panel, 0, 0, 15, 0); break;
+    case 6: funcs->pfnRectFill(panel, &rect, 0); break;
+    }
+    return CycleCount() - start;
+}
+
+void printPrimitivesUART()
+{
+    int i;
+
+    for (i = 0; i < NUMPRIMITIVES; i++)
+    {
+        UARTPutString(primitiveNames[i]);
+        UARTPutString(" generic ");
+        UARTPutNumber(timePrimitive(&g_sCrystalfontz128x128_genericFuncs, i));
+        UARTPutString(" specialized ");
+        UARTPutNumber(timePrimitive(&g_sCrystalfontz128x128_funcs, i));
+        UARTPutString(" cycles\r\n");
+    }
+    printMessageLCD();//drawn over
+}
+
+void printHotPathsUART()
+{
+    UARTPutString((uintptr_t)expandGlyphRow >= SRAM_CODE_START ? "hot paths in SRAM\r\n" : "hot paths in flash, RAMFUNC is off\r\n");
+    hotPathPut("glyph run", timeGlyphRow(expandGlyphRowFlash), timeGlyphRow(expandGlyphRow));
+    hotPathPut("spi 64B", timeSpiWrite(HAL_LCD_writeDataBufferFlash), timeSpiWrite(HAL_LCD_writeDataBuffer));
+    hotPathPut("qoi run", timeQoiRun(qoiEmitFlash), timeQoiRun(qoiEmit));
+    hotPathPut("ring", timeRing(rxRingPutFlash, UARTGetCharFlash), timeRing(rxRingPut, UARTGetChar));
+    printPrimitivesUART();
+}
+
+//------------------------------------------
+// Loopback benchmark
+//
+// #l<n> (or holding S1 through reset) puts EUSCI_A0 into internal loopback
+// with UCLISTEN and, at each rate in turn, sends BENCHBYTES of pattern n
+// from the TX interrupt as fast as the line allows. Everything comes back
+// through the RX interrupt, the ring, parseCommands and write2LCD, just as
+// it would from a host. No PC is needed. For each rate this reports:
+//   sustained characters per second through the parser
+//   dropped bytes, sent but never parsed
+//   worst latency from TXBUF to the end of the parse of its batch, in us
+//   glyphs drawn per frame and SPI bytes per glyph, frames go out while the
+//   text streams in just as they do from the scheduler
+// Echo and XON/XOFF are off while it runs, since anything sent would come
+// straight back. The latency is only known for a run that dropped nothing,
+// each byte is matched with its send time by its place in the stream. The
+// colors the patterns leave behind are put back after each run.
+// #l runs inside parseCommands, so the parser state and echo it found are
+// put back when it is done. In framed mode it is ignored: the results would
+// go out in the middle of the frames, and the frame would not be ACKed
+// until the run is over.
+
+#define BENCHBYTES 2000
+#define BENCHQUIET (20 * CYCLES_PER_MS) //nothing received for this long, the run is over
+
+const char *benchPatterns[] = {
+    "The quick brown fox jumps over the lazy dog 0123456789\r\n",//plain text
+    "#f2green #f6cyan #b1on red#b4 #f7white\r\n",//commands in between
+    "\x1b[3;1H\x1b[32mansi\x1b[0m cursor \x1b[1Cand erase\x1b[K\r\n",//escape sequences
+};
+#define NUMPATTERNS ((int)(sizeof(benchPatterns) / sizeof(benchPatterns[0])))
+
+void benchPut(const char *label, uint32_t value)//one result on the LCD and the UART
+{
+    char digits[MAXCOUNTERDIGITS];
+    int len = 0;
+
+    emitText((const uint8_t *)label, strlen(label));
+    do {
+        digits[MAXCOUNTERDIGITS - 1 - len++] = value % 10 + '0';
+        value /= 10;
+    } while (value);
+    emitText((const uint8_t *)digits + MAXCOUNTERDIGITS - len, len);
+}
+
+bool frameDue();
+
+void runBenchmark(uint32_t pattern)
+{
+    UARTBaudRate_t savedBaud = baudRate, rate;
+    bool savedXonXoff = xonXoff;
+    color_t savedFg = term->fg, savedBg = term->bg;
+    uint16_t savedCustomFg = term->customFgPixel, savedCustomBg = term->customBgPixel;
+    bool savedEcho = uartEcho;
+    parseState_t savedState = term->presentState;
+    uint8_t batch[16];
+    uint32_t received, start, last, latency, worst;
+    uint32_t frames, glyphs, bytes;
+    int n;
+
+    xonXoff = false;
+    for (rate = baud9600; rate <= baud57600; rate++)
+    {
+        uartEcho = false;
+        baudRate = rate;
+        UARTSetBaud();
+        while (UARTHasChar())//nothing left over from before
+            UARTGetChar();
+        UCA0STATW |= UCLISTEN;
+
+        benchPattern = (const uint8_t *)benchPatterns[pattern];
+        benchPatternLen = strlen(benchPatterns[pattern]);
+        benchSent = 0;
+        benchTotal = BENCHBYTES;
+        received = 0;
+        worst = 0;
+        LCDRenderFrame();//the results so far are not part of the count
+        frames = frameCount;
+        glyphs = frameGlyphs;
+        bytes = HAL_LCD_listBytes;
+        start = last = CycleCount();
+        UART_enableInterrupt(EUSCI_A0_BASE, EUSCI_A_UART_TRANSMIT_INTERRUPT);//TXIFG is already set, so this starts it
+
+        while (UARTHasChar() || CycleCount() - last < BENCHQUIET)//a frame can take longer than BENCHQUIET
+        {
+            if (frameDue())
+                LCDRenderFrame();
+            if (!UARTHasChar())
+                continue;
+            n = 0;
+            while (n < (int)sizeof(batch) && UARTHasChar())
+                batch[n++] = UARTGetChar();
+            parseCommands(batch, n);
+            last = lastRxAt = CycleCount();
+            latency = last - benchSentAt[received % BENCHSTAMPS];//oldest byte of the batch
+            if (latency > worst)
+                worst = latency;
+            received += n;
+        }
+        last -= start;
+
+        UCA0STATW &= ~UCLISTEN;
+        term->presentState = idle;//a pattern cut short may leave a command open
+        uartEcho = savedEcho;
+        LCDRenderFrame();
+        HAL_LCD_waitQueue();//every byte of it counted
+        frames = frameCount - frames;
+        glyphs = frameGlyphs - glyphs;
+        bytes = HAL_LCD_listBytes - bytes;
+        term->customFgPixel = savedCustomFg;//the results go out in the colors from before the run
+        term->customBgPixel = savedCustomBg;
+        cmdSetFg(savedFg);
+        cmdSetBg(savedBg);
+        benchPut("\r\n", baudValues[rate]);
+        benchPut(" ", last ? (uint32_t)((uint64_t)received * CYCLES_PER_MS * 1000 / last) : 0);
+        benchPut("c/s\r\ndrop ", BENCHBYTES - received);
+        if (received == BENCHBYTES)
+        {
+            benchPut(" lat ", worst / (CYCLES_PER_MS / 1000));
+            emitText((const uint8_t *)"us", 2);
+        }
+        else//a dropped byte puts every later one out of step with its send time
+            emitText((const uint8_t *)" lat -", 6);
+        benchPut("\r\n", frames ? glyphs / frames : 0);
+        benchPut("g/f ", glyphs ? bytes / glyphs : 0);
+        emitText((const uint8_t *)"B/g", 3);
+    }
+    emitText((const uint8_t *)"\r\n", 2);
+
+    xonXoff = savedXonXoff;
+    term->presentState = savedState;
+    baudRate = savedBaud;
+    UARTSetBaud();
+}
+
+void cmdBenchmark(uint32_t arg)
+{
+    if (uartEcho)//not from a frame
+        runBenchmark(arg);
+}
+
+void parseResync()//a break on the line, whatever was half received is dropped
+{
+    if (term->presentState == framed)
+    {
+        frameLen = 0;
+        frameEscaped = false;
+        frameOverflow = false;
+        frameTextState = idle;
+    }
+    else
+        term->presentState = idle;
+}
+
+void cmdErrors(uint32_t arg)//receive error counts since reset
+{
+    (void)arg;
+    UARTPutString("\r\nrx overrun ");
+    UARTPutNumber(rxOverruns);
+    UARTPutString(" framing ");
+    UARTPutNumber(rxFramingErrors);
+    UARTPutString(" parity ");
+    UARTPutNumber(rxParityErrors);
+    UARTPutString(" break ");
+    UARTPutNumber(rxBreaks);
+    UARTPutString(" ring full ");
+    UARTPutNumber(rxOverflows);
+    UARTPutString(" pane rings full ");
+    UARTPutNumber(PaneOverflows());
+    UARTPutString("\r\n");
+}
+
+//parse a batch of received bytes, plain text in between commands is passed on in runs
+void parseCommands(const uint8_t *buf, int len)
+{
+    int i = 0, textStart = 0;
+
+    while (i < len)
+    {
+        if (term->presentState == framed)
+        {
+            i += parseFrameBytes(buf + i, len - i);
+            textStart = i;
+        }
+        else if (term->presentState >= imageHead)//raw image bytes, nothing in them is a command
+        {
+            i += parseImageBytes(buf + i, len - i);
+            textStart = i;
+        }
+        else if (term->presentState != idle)
+        {
+            if (term->presentState >= escape ? parseEscapeByte(buf[i]) : parseCommandByte(buf[i]))
+                i++;
+            textStart = i;
+        }
+        else if (buf[i] == 0x1B)//ESC, start of an ANSI sequence
+        {
+            emitText(buf + textStart, i - textStart);
+            term->presentState = escape;
+            textStart = ++i;
+        }
+        else if (buf[i] == '#')//if c is #, potential command
+        {
+            emitText(buf + textStart, i - textStart);
+            term->presentState = opcode;
+            term->commandText[0] = '#';
+            term->commandLen = 1;
+            term->firstMatch = 0;
+            term->lastMatch = NUMCOMMANDS - 1;
+            term->opcodeLen = 0;
+            term->matched = 0;
+            textStart = ++i;
+        }
+        else
+            i++;
+    }
+
+    if (term->presentState == idle)
+        emitText(buf + textStart, len - textStart);
+}
+
+void InitColorLED()//initalize booster board LED
+{
+    GPIO_setAsOutputPin    (GPIO_PORT_P2,    GPIO_PIN6);   // color LED red on sensor board
+    GPIO_setAsOutputPin    (GPIO_PORT_P2,    GPIO_PIN4);   // color LED green on sensor board
+    GPIO_setAsOutputPin    (GPIO_PORT_P5,    GPIO_PIN6);   // color LED blue on sensor board
+
+    GPIO_setOutputLowOnPin (GPIO_PORT_P2,    GPIO_PIN6);
+    GPIO_setOutputLowOnPin (GPIO_PORT_P2,    GPIO_PIN4);
+    GPIO_setOutputLowOnPin (GPIO_PORT_P5,    GPIO_PIN6);
+}
+
+bool ledLit = false;//turned off by the LED task once the 200ms are up
+
+void LEDchange(uint8_t character)
+{
+    ledLit = true;
+    Init200msTimer();//init timers and color LEDS
+    InitColorLED();
+
+    if (character == '#')//hash character, white LED
+    {
+        color = white;
+        Timer200msStartOneShot();//start timer
+        ColorLEDSet(color);
+    }
+    else if (character >= '0' && character <= '9')//number, red LED
+    {
+        color = red;
+        Timer200msStartOneShot();//start timer
+        ColorLEDSet(color);
+    }
+    else if (character >= 'A' && character <= 'Z' || character >= 'a' && character <= 'z')//letter, blue LED
+    {
+        color = blue;
+        Timer200msStartOneShot();
+        ColorLEDSet(color);//change LED
+    }
+    else //none of the above, green LED
+    {
+        color = green;
+        Timer200msStartOneShot();
+        ColorLEDSet(color);
+    }
+}
+
+//------------------------------------------
+// Scheduler
+//
+// The main loop is a run-to-completion scheduler. Each pass it marks the
+// tasks that have work as waiting and runs one of them: a waiting task that
+// has used up half of its deadline if there is one, otherwise the waiting
+// task with the highest priority. A steady stream on the UART can't keep the
+// others past their deadlines that way. In priority order:
+//   rx      one batch from the console and one from each pane, flow control
+//           and auto baud
+//   render  a frame of text and the counter every 1/frameRate s, or as soon
+//           as the input has stopped for FRAMEIDLE, and scrollback pages a
+//           run at a time. Each run stops at RENDERSLICE, a frame or a page
+//           goes on from where it stopped in the next run
+//   input   S1 and S2, every INPUTPERIOD
+//   led     the color LED off once its 200ms are up
+//   store   the settings store, every STOREPERIOD
+// #p reports, per task, the longest wait from ready to run and the longest
+// run since the last #p, and how many runs started past the deadline.
+
+#define RENDERSLICE (2 * CYCLES_PER_MS)
+#define FRAMEIDLE (2 * CYCLES_PER_MS) //nothing came in for this long, draw without waiting for the frame
+#define INPUTPERIOD (5 * CYCLES_PER_MS)
+#define STOREPERIOD (100 * CYCLES_PER_MS)
+
+typedef struct task {
+    const char *name;
+    bool (*ready)(const struct task *t);//has work waiting
+    void (*run)();
+    uint32_t deadline;//cycles it may wait once ready
+    bool waiting;
+    uint32_t readyAt, lastRun;
+    uint32_t runs, late;
+    uint32_t maxWait, maxRun;
+} task_t;
+
+bool rxReady(const task_t *t) {
+    (void)t;
+    return UARTHasChar() || UARTAtBreak() || autoBaudDone || PaneWaiting();
+}
+
+void rxRun() {
+    uint8_t batch[16];
+    int n;
+
+    if (UARTHasChar() || PaneWaiting())
+        lastRxAt = CycleCount();
+    if (UARTAtBreak())//start over from the break
+    {
+        UARTClearBreak();
+        parseResync();
+    }
+
+    if (UARTHasChar() && !UARTAtBreak())//if char available on UART
+    {
+        n = 0;
+        while (n < (int)sizeof(batch) && UARTHasChar() && !UARTAtBreak())//take everything that is waiting, up to a break
+            batch[n++] = UARTGetChar();
+        LCDShowLive();//new text always shows up on the live screen
+        charCounter += n;//increment
+        LEDchange(batch[n - 1]);//change LED on booster, the last char is the one that shows
+        parseCommands(batch, n);//send chars to parse
+    }
+
+    PanePoll();//then a turn for each of the other panes
+
+    if (term->presentState != framed)//frames carry credits instead
+        UARTFlowControl();
+
+    if (UARTAutoBaud())//host sent break and sync at a new rate
+        LCDUpdateStatusField(0, 8);
+}
+
+bool frameDue() {//something to draw, and the frame time is up or the input has stopped
+    uint32_t now = CycleCount();
+
+    if (!screenDirty && counterShown == charCounter)
+        return false;
+    return frameRate == 0 || now - frameAt >= CYCLES_PER_MS * 1000 / frameRate || now - lastRxAt >= FRAMEIDLE;
+}
+
+void cmdFrameRate(uint32_t arg) { frameRate = arg; }//#r<n>; frames per second, #r0; draws as text is parsed
+
+bool renderReady(const task_t *t) {
+    (void)t;
+    return historyPending || renderRow > 0 || frameDue();
+}
+
+void renderRun() {
+    uint32_t start = CycleCount(), used;
+
+    if (renderRow > 0 || frameDue())
+    {
+        if (!LCDRenderStep(RENDERSLICE))//all the text parsed since the last frame, or as much as fits
+            return;
+        LCDUpdateCounter();//and the counter with it
+    }
+    used = CycleCount() - start;
+    LCDHistoryStep(used < RENDERSLICE ? RENDERSLICE - used : 0);//what doesn't fit waits for the next slice
+}
+
+bool inputReady(const task_t *t) {
+    return CycleCount() - t->lastRun >= INPUTPERIOD;
+}
+
+void inputRun() {
+    static bool buttonDebounce = false, prev_buttonDebounce;
+    static bool button = false, prev_button;
+    static gestureFSM_t s1Gesture = {false};
+    gesture_t gesture;
+
+    checkButton2Status(&button, &prev_button, &prev_buttonDebounce, &buttonDebounce);//if button is pressed change baud rate
+
+    gesture = ButtonGesture(&s1Gesture, ButtonS1Pressed(), GESTUREDEBOUNCE);
+    if (gesture == gestureShort)//if button 1 pressed, the LCD status is already live
+    {
+        printMessageUART();//print status message on UART
+    }
+    else if (gesture == gestureLong)//held, page back through the scrollback
+    {
+        LCDPageHistory(1);
+    }
+}
+
+bool ledReady(const task_t *t) {
+    (void)t;
+    return ledLit && Timer200msExpiredOneShot();
+}
+
+void ledRun() {
+    ColorLEDSet(black);//turn LED off
+    ledLit = false;
+}
+
+bool storeReady(const task_t *t) {
+    return SETTINGS_STORE && CycleCount() - t->lastRun >= STOREPERIOD;
+}
+
+void storeRun() {
+    SettingsPoll();//saved to flash once things settle
+}
+
+task_t tasks[] = {//in priority order
+    {"rx",     rxReady,     rxRun,     5 * CYCLES_PER_MS},
+    {"render", renderReady, renderRun, 50 * CYCLES_PER_MS},
+    {"input",  inputReady,  inputRun,  10 * CYCLES_PER_MS},
+    {"led",    ledReady,    ledRun,    20 * CYCLES_PER_MS},
+    {"store",  storeReady,  storeRun,  1000 * CYCLES_PER_MS},
+};
+#define NUMTASKS ((int)(sizeof(tasks) / sizeof(tasks[0])))
+
+void SchedulerStep() {//one pass of the main loop
+    uint32_t now = CycleCount(), wait, ran;
+    task_t *next = 0;
+    int i;
+
+    for (i = 0; i < NUMTASKS; i++)
+    {
+        if (!tasks[i].waiting && tasks[i].ready(&tasks[i]))
+        {
+            tasks[i].waiting = true;
+            tasks[i].readyAt = now;
+        }
+    }
+    for (i = 0; i < NUMTASKS && !next; i++)//half its deadline gone, runs first
+        if (tasks[i].waiting && now - tasks[i].readyAt > tasks[i].deadline / 2)
+            next = &tasks[i];
+    for (i = 0; i < NUMTASKS && !next; i++)
+        if (tasks[i].waiting)
+            next = &tasks[i];
+    if (!next)
+        return;
+
+    next->waiting = false;
+    now = CycleCount();
+    wait = now - next->readyAt;
+    next->run();
+    ran = CycleCount() - now;
+
+    next->lastRun = now;
+    next->runs++;
+    if (wait > next->deadline)
+        next->late++;
+    if (wait > next->maxWait)
+        next->maxWait = wait;
+    if (ran > next->maxRun)
+        next->maxRun = ran;
+}
+
+void printSchedulerUART()//per task stats since the last #p
+{
+    int i;
+
+    for (i = 0; i < NUMTASKS; i++)
+    {
+        UARTPutString("task ");
+        UARTPutString(tasks[i].name);
+        UARTPutString(": ");
+        UARTPutNumber(tasks[i].runs);
+        UARTPutString(" runs, wait max ");
+        UARTPutNumber(tasks[i].maxWait / (CYCLES_PER_MS / 1000));
+        UARTPutString(" us, run max ");
+        UARTPutNumber(tasks[i].maxRun / (CYCLES_PER_MS / 1000));
+        UARTPutString(" us, late ");
+        UARTPutNumber(tasks[i].late);
+        UARTPutString("\r\n");
+        tasks[i].runs = tasks[i].late = tasks[i].maxWait = tasks[i].maxRun = 0;
+    }
+    UARTPutString("frames: ");
+    UARTPutNumber(frameCount);
+    UARTPutString(" at ");
+    UARTPutNumber(frameRate);
+    UARTPutString("/s, glyphs per frame ");
+    UARTPutNumber(frameCount ? frameGlyphs / frameCount : 0);
+    UARTPutString(", max ");
+    UARTPutNumber(frameMaxGlyphs);
+    UARTPutString("\r\n");
+    frameCount = frameGlyphs = frameMaxGlyphs = 0;
+}
+
+//-----------------------------------------------------------------------
+
+int main(void) {
+    WDT_A_hold(WDT_A_BASE);
+    InitCycleCounter();
+    bootStart = CycleCount();
+    InitTerms();
+    InitCommands();
+
+    Crystalfontz128x128_InitStart();//panel reset, the rest is done while it waits
+    SettingsLoad();//baud, colors, mode and counter from the last power cycle, with SETTINGS_STORE
+    InitUART();
+    if (baudRate != baud9600)
+        UARTSetBaud();
+    InitRedLED();
+    InitButtonS1();
+    InitButtonS2();
+    InitColorLED();
+    Init200msTimer();
+    InitTimerDebounce();
+    InitCRC32();
+    while (!Crystalfontz128x128_InitStep());//what is left of the 120ms reset wait
+    InitGraphics();
+
+    printMessageLCD();//status rows are live from here on
+    term->rowNum = term->top;
+    bootCycles = CycleCount() - bootStart;
+
+    if (ButtonS1Pressed())//held through reset, qualify the board without a PC
+        runBenchmark(0);
+
+    while (1)
+        SchedulerStep();
 }
@@ -0,0 +1,408 @@
+/*
+ * Host stand-ins for the driverlib, GRLIB and LcdDriver calls main.c makes,
+ * so the firmware can be built and driven on a PC.
+ *
+ *   clock   DWT->CYCCNT is a plain counter, the tests move it forward and
+ *           the panel model adds the cost of every byte it is sent. Each
+ *           read costs stubClockStep, for loops that spin on the clock
+ *   UART    bytes sent on EUSCI_A0 are kept in stubTx, stubReceive feeds a
+ *           byte through EUSCIA0_IRQHandler the way the eUSCI would. With
+ *           UCLISTEN they come back to RX at the rate in UCA0BRW instead,
+ *           and the TX interrupt fires whenever TXBUF is free
+ *   flash   INFO flash is stubInfo, where the settings store goes, and
+ *           the power can be cut partway through an erase or a program
+ *   panel   a 128x128 RGB565 frame buffer written through the same window
+ *           and display list calls the driver has
+ *   font    g_sFontFixed6x8 glyphs carry their character code in pixel rows
+ *           0 and 1, row 6 is all foreground and row 7 all background, so
+ *           stubPanelCell can read a text cell back off the panel
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "ti/devices/msp432p4xx/driverlib/driverlib.h"
+#include "ti/grlib/grlib.h"
+#include "../LcdDriver/Crystalfontz128x128_ST7735.h"
+#include "../LcdDriver/HAL_MSP_EXP432P401R_Crystalfontz128x128_ST7735.h"
+#include "../LcdDriver/Canvas_RGB565.h"
+#include "hal_stub.h"
+
+//------------------------------------------
+// Registers and clock
+
+volatile uint16_t UCB0STATW, UCB0TXBUF, UCB0IFG = UCTXIFG, UCB0IE;
+volatile uint16_t UCA0STATW, UCA0RXBUF, UCA0TXBUF, UCA0IFG = UCTXIFG, UCA0IE, UCA0BRW, UCA0MCTLW, UCA0CTLW0, UCA0ABCTL;
+
+DWT_Type dwt;
+static CoreDebug_Type coreDebug;
+CoreDebug_Type *CoreDebug = &coreDebug;
+
+uint32_t stubBlitCycles = 0;//panel cost per byte sent, 0 makes drawing free
+uint32_t stubClockStep = 0;//cost of each read of the clock, 0 leaves it to the test
+
+static void loopbackStep(void);
+
+DWT_Type *stubClock(void)//what DWT points at, the loopback moves on whenever the firmware looks at the time
+{
+    static bool inside = false;//the interrupt it runs reads the clock too
+
+    if (!inside)
+    {
+        inside = true;
+        dwt.CYCCNT += stubClockStep;
+        loopbackStep();
+        inside = false;
+    }
+    return &dwt;
+}
+
+uint32_t CS_getMCLK(void) { return 3000000; }
+uint32_t CS_getSMCLK(void) { return 3000000; }
+void WDT_A_hold(uint32_t base) { (void)base; }
+void SysCtl_rebootDevice(void) {}
+void SysCtlDelay(uint32_t count) { (void)count; }
+
+//------------------------------------------
+// UART
+
+uint8_t stubTx[STUBTXSIZE];
+int stubTxLen = 0;
+static uint8_t rxData[4];//what each eUSCI_A RXBUF holds
+
+static int portIndex(uint32_t base) { return (base - EUSCI_A0_BASE) / 0x400 & 3; }
+
+bool UART_initModule(uint32_t base, const eUSCI_UART_Config *config) { (void)base; (void)config; return true; }
+void UART_enableModule(uint32_t base) { (void)base; }
+void UART_disableModule(uint32_t base) { (void)base; }
+uint_fast8_t UART_getInterruptStatus(uint32_t base, uint8_t mask) { (void)base; return mask & EUSCI_A_UART_TRANSMIT_INTERRUPT_FLAG; }
+uint_fast8_t UART_getEnabledInterruptStatus(uint32_t base) { (void)base; return 0; }
+void UART_clearInterruptFlag(uint32_t base, uint_fast8_t mask) { (void)base; (void)mask; }
+uint32_t stubUartResets = 0;
+
+void UART_enableInterrupt(uint32_t base, uint_fast8_t mask)//main.c enables them again after every UCSWRST, which cleared them
+{
+    if (base == EUSCI_A0_BASE && (mask & EUSCI_A_UART_RECEIVE_INTERRUPT))
+        stubUartResets++;
+    if (base == EUSCI_A0_BASE && (mask & EUSCI_A_UART_TRANSMIT_INTERRUPT))
+        UCA0IE |= UCTXIE;
+}
+
+void UART_disableInterrupt(uint32_t base, uint_fast8_t mask)
+{
+    if (base == EUSCI_A0_BASE && (mask & EUSCI_A_UART_TRANSMIT_INTERRUPT))
+        UCA0IE &= ~UCTXIE;
+}
+
+uint8_t UART_receiveData(uint32_t base)
+{
+    if (base == EUSCI_A0_BASE)
+        UCA0IFG &= ~UCRXIFG;
+    return rxData[portIndex(base)];
+}
+
+static bool loopBusy = false;//a character on its way from TXBUF back to RXBUF
+static bool loopLanding = false;//the interrupt for the one that came in at loopDoneAt is running
+static uint8_t loopChar;
+static uint32_t loopDoneAt;
+
+void UART_transmitData(uint32_t base, uint_fast8_t data)
+{
+    if (base == EUSCI_A0_BASE && (UCA0STATW & UCLISTEN))//start, 8 data and stop bits at 16 clocks plus UCBRF a bit
+    {
+        loopChar = data;
+        loopBusy = true;
+        loopDoneAt = (loopLanding ? loopDoneAt : dwt.CYCCNT) + 10 * (UCA0BRW * 16 + (UCA0MCTLW >> 4 & 15));
+        UCA0IFG &= ~UCTXIFG;
+    }
+    else if (base == EUSCI_A0_BASE && stubTxLen < STUBTXSIZE)
+        stubTx[stubTxLen++] = data;
+}
+
+void EUSCIA0_IRQHandler(void);
+
+void stubReceive(uint8_t c, uint16_t status)
+{
+    rxData[0] = c;
+    UCA0STATW = (UCA0STATW & UCLISTEN) | status;
+    UCA0IFG |= UCRXIFG;
+    EUSCIA0_IRQHandler();
+    UCA0STATW &= UCLISTEN;
+}
+
+//every character that landed since the last look, each one through the
+//interrupt at the time it came in, however long the firmware was drawing
+static void loopbackStep(void)
+{
+    while (loopBusy && (int32_t)(dwt.CYCCNT - loopDoneAt) >= 0)//TXBUF is free again as the character lands in RXBUF
+    {
+        loopBusy = false;
+        UCA0IFG |= UCTXIFG;
+        loopLanding = true;
+        stubReceive(loopChar, 0);
+        loopLanding = false;
+    }
+    if (!loopBusy && (UCA0IE & UCTXIE) && (UCA0IFG & UCTXIFG))//just enabled with TXBUF empty
+        EUSCIA0_IRQHandler();
+}
+
+//------------------------------------------
+// GPIO, timers, interrupts
+
+void GPIO_setAsPeripheralModuleFunctionInputPin(uint_fast8_t port, uint_fast16_t pins, uint_fast8_t mode) { (void)port; (void)pins; (void)mode; }
+void GPIO_setAsPeripheralModuleFunctionOutputPin(uint_fast8_t port, uint_fast16_t pins, uint_fast8_t mode) { (void)port; (void)pins; (void)mode; }
+void GPIO_setAsOutputPin(uint_fast8_t port, uint_fast16_t pins) { (void)port; (void)pins; }
+void GPIO_setAsInputPin(uint_fast8_t port, uint_fast16_t pins) { (void)port; (void)pins; }
+void GPIO_setOutputLowOnPin(uint_fast8_t port, uint_fast16_t pins) { (void)port; (void)pins; }
+void GPIO_setOutputHighOnPin(uint_fast8_t port, uint_fast16_t pins) { (void)port; (void)pins; }
+void GPIO_toggleOutputOnPin(uint_fast8_t port, uint_fast16_t pins) { (void)port; (void)pins; }
+uint8_t GPIO_getInputPinValue(uint_fast8_t port, uint_fast16_t pins) { (void)port; (void)pins; return 1; }//buttons are pulled up
+
+void Timer32_initModule(uint32_t base, uint32_t prescaler, uint32_t resolution, uint32_t mode) { (void)base; (void)prescaler; (void)resolution; (void)mode; }
+void Timer32_setCount(uint32_t base, uint32_t count) { (void)base; (void)count; }
+void Timer32_startTimer(uint32_t base, bool oneShot) { (void)base; (void)oneShot; }
+uint32_t Timer32_getValue(uint32_t base) { (void)base; return 0; }
+
+void Interrupt_enableInterrupt(uint32_t n) { (void)n; }
+void Interrupt_disableInterrupt(uint32_t n) { (void)n; }
+void Interrupt_enableMaster(void) {}
+bool Interrupt_disableMaster(void) { return true; }
+
+//------------------------------------------
+// CRC32 module, bit reversed CRC-32 like the hardware
+
+static uint32_t crc;
+
+void CRC32_setSeed(uint32_t seed, uint_fast8_t type) { (void)type; crc = seed; }
+
+void CRC32_set8BitData(uint8_t data, uint_fast8_t type)
+{
+    int k;
+    (void)type;
+    crc ^= data;
+    for (k = 0; k < 8; k++)
+        crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+}
+
+uint32_t CRC32_getResultReversed(uint_fast8_t type) { (void)type; return crc; }
+
+uint32_t CRC32_getResult(uint_fast8_t type)
+{
+    uint32_t r = 0;
+    int k;
+    (void)type;
+    for (k = 0; k < 32; k++)
+        if (crc & (1u << k))
+            r |= 1u << (31 - k);
+    return r;
+}
+
+//------------------------------------------
+// Flash, only INFO, in stubInfo. Programming can only clear bits, and the
+// power can go after stubFlashBudget bytes of an erase or a program
+
+uint8_t stubInfo[STUBINFOSIZE];
+int32_t stubFlashBudget = -1;
+uint32_t stubInfoErases[STUBINFOSECTORS], stubInfoPrograms[STUBINFOSECTORS];
+
+static bool flashByte(void)//false once the power is gone
+{
+    if (stubFlashBudget == 0)
+        return false;
+    if (stubFlashBudget > 0)
+        stubFlashBudget--;
+    return true;
+}
+
+static int infoSector(uintptr_t addr)//-1 outside INFO
+{
+    uintptr_t at = addr - (uintptr_t)stubInfo;
+
+    return at < STUBINFOSIZE ? (int)(at / STUBINFOSECTOR) : -1;
+}
+
+bool FlashCtl_unprotectSector(uint_fast8_t space, uint32_t mask) { (void)space; (void)mask; return true; }
+bool FlashCtl_protectSector(uint_fast8_t space, uint32_t mask) { (void)space; (void)mask; return true; }
+
+bool FlashCtl_eraseSector(uintptr_t addr)
+{
+    int sector = infoSector(addr), i;
+
+    if (sector < 0)
+        return false;
+    stubInfoErases[sector]++;
+    for (i = 0; i < STUBINFOSECTOR; i++)
+    {
+        if (!flashByte())
+            return false;
+        stubInfo[sector * STUBINFOSECTOR + i] = 0xFF;
+    }
+    return true;
+}
+
+bool FlashCtl_programMemory(void *src, void *dest, uint32_t length)
+{
+    int sector = infoSector((uintptr_t)dest);
+    uint32_t i;
+
+    if (sector < 0 || infoSector((uintptr_t)dest + length - 1) != sector)
+        return false;
+    stubInfoPrograms[sector]++;
+    for (i = 0; i < length; i++)
+    {
+        if (!flashByte())
+            return false;
+        ((uint8_t *)dest)[i] &= ((const uint8_t *)src)[i];
+    }
+    return true;
+}
+
+//------------------------------------------
+// Panel
+
+uint16_t stubPanel[128][128];//RGB565
+static int winX0, winY0, winX1, winY1, winX, winY;
+
+static void panelPut(uint16_t pixel)
+{
+    stubPanel[winY][winX] = pixel;
+    if (++winX > winX1)
+    {
+        winX = winX0;
+        if (++winY > winY1)
+            winY = winY0;
+    }
+}
+
+uint32_t HAL_LCD_listMaxDepth, HAL_LCD_listFullWaits, HAL_LCD_listBytes, HAL_LCD_spiClock = 3000000;
+
+void HAL_LCD_writeCommand(uint8_t command) { (void)command; }
+void HAL_LCD_writeData(uint8_t data) { (void)data; }
+
+void HAL_LCD_writeDataBuffer(const uint8_t *data, uint16_t length)//pixels straight into the window, as #i sends them
+{
+    uint16_t i;
+
+    dwt.CYCCNT += stubBlitCycles * length;
+    for (i = 0; i + 1 < length; i += 2)
+        panelPut(data[i] << 8 | data[i + 1]);
+}
+
+void HAL_LCD_writeDataBufferFlash(const uint8_t *data, uint16_t length) { HAL_LCD_writeDataBuffer(data, length); }
+
+void HAL_LCD_queueFill(uint16_t color, uint32_t count)
+{
+    HAL_LCD_listBytes += 2 * count;
+    dwt.CYCCNT += stubBlitCycles * 2 * count;
+    while (count--)
+        panelPut(color);
+}
+
+void HAL_LCD_queueBlit(const uint8_t *data, uint32_t length)
+{
+    uint32_t i;
+
+    HAL_LCD_listBytes += length;
+    dwt.CYCCNT += stubBlitCycles * length;
+    for (i = 0; i + 1 < length; i += 2)
+        panelPut(data[i] << 8 | data[i + 1]);
+}
+
+uint32_t HAL_LCD_queueFence(void) { return 0; }
+bool HAL_LCD_fenceDone(uint32_t fence) { (void)fence; return true; }
+void HAL_LCD_waitFence(uint32_t fence) { (void)fence; }
+void HAL_LCD_waitQueue(void) {}
+uint32_t HAL_LCD_queueDepth(void) { return 0; }
+
+Graphics_Display g_sCrystalfontz128x128;
+Graphics_Display_Functions g_sCrystalfontz128x128_funcs;
+const Graphics_Display_Functions g_sCrystalfontz128x128_genericFuncs;
+const Graphics_Display_Functions g_sCanvasRGB565_funcs;
+
+void Crystalfontz128x128_Init(void) {}
+void Crystalfontz128x128_InitStart(void) {}
+bool Crystalfontz128x128_InitStep(void) { return true; }
+void Crystalfontz128x128_DisplayOn(void) {}
+void Crystalfontz128x128_SetOrientation(uint8_t orientation) { (void)orientation; }
+void Crystalfontz128x128_SetDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) { Crystalfontz128x128_QueueDrawFrame(x0, y0, x1, y1); }
+
+void Crystalfontz128x128_QueueDrawFrame(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1)
+{
+    HAL_LCD_listBytes += 11;//CASET, RASET and RAMWR
+    winX = winX0 = x0 & 127;
+    winY = winY0 = y0 & 127;
+    winX1 = x1 & 127;
+    winY1 = y1 & 127;
+}
+
+void Crystalfontz128x128_Fill(uint16_t color)
+{
+    Crystalfontz128x128_QueueDrawFrame(0, 0, 127, 127);
+    HAL_LCD_queueFill(color, 128 * 128);
+}
+
+uint32_t Crystalfontz128x128_Blit(const Graphics_Display *canvas, uint16_t x, uint16_t y) { (void)canvas; (void)x; (void)y; return 0; }
+void Canvas_RGB565_init(Graphics_Display *canvas, uint16_t *pixels, uint16_t width, uint16_t height) { (void)canvas; (void)pixels; (void)width; (void)height; }
+
+//------------------------------------------
+// Fonts and GRLIB
+
+#define OFFSETS4(i) (i) * 8, ((i) + 1) * 8, ((i) + 2) * 8, ((i) + 3) * 8
+#define OFFSETS16(i) OFFSETS4(i), OFFSETS4((i) + 4), OFFSETS4((i) + 8), OFFSETS4((i) + 12)
+
+static uint8_t fixedData[96 * 8];//filled in by buildFont
+const Graphics_Font g_sFontCmtt16;
+const Graphics_Font g_sFontFixed6x8 = {GRAPHICS_FONT_FMT_UNCOMPRESSED, 6, 8, 7,
+    {OFFSETS16(0), OFFSETS16(16), OFFSETS16(32), OFFSETS16(48), OFFSETS16(64), OFFSETS16(80)}, fixedData};
+
+static void setRow(uint8_t *bits, int row, unsigned value)//6 pixels, MSB first
+{
+    int px;
+    for (px = 0; px < 6; px++)
+        if (value & (0x20 >> px))
+            bits[(row * 6 + px) >> 3] |= 0x80 >> ((row * 6 + px) & 7);
+}
+
+__attribute__((constructor)) static void buildFont(void)
+{
+    int i;
+
+    for (i = 0; i < 96; i++)
+    {
+        uint8_t *glyph = fixedData + i * 8;
+        unsigned code = ' ' + i;
+        glyph[0] = 8;
+        glyph[1] = 6;
+        setRow(glyph + 2, 0, code & 0x3F);
+        setRow(glyph + 2, 1, code >> 6);
+        setRow(glyph + 2, 6, 0x3F);
+    }
+}
+
+bool stubPanelCell(int row, int col, char *c, uint16_t *fg, uint16_t *bg)
+{
+    int x = col * 6, y = row * 8, px;
+    unsigned code = 0;
+
+    *fg = stubPanel[y + 6][x];
+    *bg = stubPanel[y + 7][x];
+    for (px = 0; px < 6; px++)
+    {
+        if (stubPanel[y][x + px] == *fg)
+            code |= 0x20 >> px;
+        if (stubPanel[y + 1][x + px] == *fg)
+            code |= (0x20 >> px) << 6;
+    }
+    *c = (char)code;
+    return *fg != *bg && code >= ' ' && code <= '~';
+}
+
+void Graphics_initContext(Graphics_Context *context, const Graphics_Display *display, const Graphics_Display_Functions *funcs) { (void)context; (void)display; (void)funcs; }
+void Graphics_setForegroundColor(Graphics_Context *context, int32_t value) { (void)context; (void)value; }
+void Graphics_setBackgroundColor(Graphics_Context *context, int32_t value) { (void)context; (void)value; }
+void Graphics_setForegroundColorTranslated(Graphics_Context *context, uint16_t value) { (void)context; (void)value; }
+void Graphics_setBackgroundColorTranslated(Graphics_Context *context, uint16_t value) { (void)context; (void)value; }
+void GrContextFontSet(Graphics_Context *context, const Graphics_Font *font) { (void)context; (void)font; }
+void Graphics_setFont(Graphics_Context *context, const Graphics_Font *font) { (void)context; (void)font; }
+void Graphics_clearDisplay(Graphics_Context *context) { (void)context; }
+void Graphics_drawString(Graphics_Context *context, int8_t *s, int32_t len, int32_t x, int32_t y, bool opaque) { (void)context; (void)s; (void)len; (void)x; (void)y; (void)opaque; }
+void Graphics_fillRectangle(Graphics_Context *context, const Graphics_Rectangle *rect) { (void)context; (void)rect; }
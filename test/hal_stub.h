@@ -0,0 +1,40 @@
+/*
+ * What hal_stub.c gives the tests on top of the driverlib and LcdDriver
+ * stand-ins.
+ */
+#ifndef HAL_STUB_H
+#define HAL_STUB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ti/devices/msp432p4xx/driverlib/driverlib.h"
+
+#define STUBTXSIZE 65536
+
+extern DWT_Type dwt;//dwt.CYCCNT is the clock
+extern uint32_t stubClockStep;//cycles each read of it takes
+extern uint32_t stubBlitCycles;//panel cost per byte sent
+
+extern uint8_t stubTx[STUBTXSIZE];//everything sent on EUSCI_A0
+extern int stubTxLen;
+
+//one character arriving on EUSCI_A0 with UCA0STATW = status, through the RX interrupt
+void stubReceive(uint8_t c, uint16_t status);
+
+extern uint32_t stubUartResets;//times EUSCI_A0 came out of UCSWRST, a byte on the wire then is lost
+
+extern uint16_t stubPanel[128][128];//RGB565, row major
+
+#define STUBINFOSECTOR 4096
+#define STUBINFOSECTORS 4 //mailbox, TLV, BSL and bank 1 sector 1
+#define STUBINFOSIZE (STUBINFOSECTOR * STUBINFOSECTORS)
+
+extern uint8_t stubInfo[STUBINFOSIZE];//INFO flash from 0x200000
+extern int32_t stubFlashBudget;//bytes erased or programmed before the power goes, -1 never
+extern uint32_t stubInfoErases[STUBINFOSECTORS], stubInfoPrograms[STUBINFOSECTORS];
+
+//reads fixed 6x8 text cell row, col back off the panel, false if it doesn't
+//hold a glyph
+bool stubPanelCell(int row, int col, char *c, uint16_t *fg, uint16_t *bg);
+
+#endif
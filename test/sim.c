@@ -0,0 +1,193 @@
+/*
+ * Whole-firmware simulation on the host: the scheduler runs against the
+ * simulated clock, and bytes from the host arrive on EUSCI_A0 at the line
+ * rate, through the RX interrupt, whatever the main loop is busy with.
+ *
+ * Time only moves when something costs it. The panel model charges
+ * stubBlitCycles per byte drawn, each pass of the main loop costs
+ * SIMSTEPCYCLES, and every byte taken out of the RX ring costs
+ * simByteCycles. An idle main loop skips ahead to the next byte.
+ * simMaxRxAge is the longest any byte waited in the RX ring, which is the
+ * latency the rx task's deadline is about. The task's own wait only starts
+ * when the scheduler sees the byte.
+ *
+ * The line also carries breaks, and after one the eUSCI's detection mode
+ * times the next character at whatever rate the host is on. A character
+ * that is on the wire while EUSCI_A0 goes through UCSWRST is lost, and
+ * counted in simLost.
+ *
+ * Built into build/libsim.so for the Python tests (test_framed.py drives
+ * tools/framed_send.py through it), and included by C tests that want the
+ * same loop.
+ */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include "hal_stub.h"
+
+#define SIMCLOCK 3000000
+#define SIMSTEPCYCLES 40 //one pass of the scheduler with nothing to run
+#define SIMLINESIZE (1 << 20) //bytes the host has written that are not on the wire yet
+#define SIMLOGLINES 65536
+#define SIMLOGWIDTH (MAXCOLS + 1)
+
+#define SIMBREAK 0x100 //on the line, a break instead of a character
+
+uint32_t simByteCycles = 60;//parsing and drawing one received byte into screenChars
+uint32_t simLost = 0;//characters the eUSCI was reset under
+
+static uint16_t simLine[SIMLINESIZE];
+static uint32_t simLineHead = 0, simLineTail = 0;
+static uint32_t simCharCycles;//one character on the wire, start and stop bits included
+static uint32_t simNextAt;//when the next character on the wire is complete
+static uint32_t simResetAt;//when EUSCI_A0 last came out of UCSWRST
+static bool simAfterBreak = false;
+static uint32_t simArrivedAt[RXRINGSIZE];//when the byte in each ring slot came in
+uint32_t simMaxRxAge = 0;//longest a byte sat in the ring before the rx task took it
+
+//every console line that went into the scrollback, in order, so a test can
+//check nothing was lost or run twice however far the ring has wrapped
+static char simLog[SIMLOGLINES][SIMLOGWIDTH];
+uint32_t simLogLines = 0;
+static int simHistorySeen = 0;
+
+static void simLogHistory(void)
+{
+    while (simHistorySeen != historyNext)
+    {
+        if (simLogLines < SIMLOGLINES)
+        {
+            memcpy(simLog[simLogLines], historyChars[simHistorySeen], MAXCOLS);
+            simLog[simLogLines][MAXCOLS] = 0;
+        }
+        simLogLines++;
+        simHistorySeen = (simHistorySeen + 1) % SCROLLBACK_LINES;
+    }
+}
+
+//boots like main() does, with the console at rate and the dense text mode
+void simInit(int rate, uint32_t blitCycles)
+{
+    InitCycleCounter();
+    InitTerms();
+    InitCommands();
+    InitUART();
+    while (UARTHasChar())//whatever the last run left in the ring
+        UARTGetChar();
+    UARTClearBreak();
+    baudRate = (UARTBaudRate_t)rate;
+    UARTSetBaud();
+    InitCRC32();
+    InitGraphics();
+    LCDSetTermMode(termFixed6x8);
+    printMessageLCD();
+    term->rowNum = term->top;
+
+    stubBlitCycles = blitCycles;
+    stubTxLen = 0;
+    simCharCycles = SIMCLOCK * 10 / baudValues[rate];
+    simNextAt = CycleCount();
+    simResetAt = CycleCount() - 1;//InitUART's reset, before anything is sent
+    simAfterBreak = false;
+    simLineHead = simLineTail = 0;
+    simMaxRxAge = 0;
+    simLost = 0;
+    simLogLines = 0;
+    simHistorySeen = historyNext;
+}
+
+void simSend(const uint8_t *data, int len)//the host writes, the bytes go out at the line rate
+{
+    if (simLineHead == simLineTail)//the line was idle
+        simNextAt = CycleCount() + simCharCycles;
+    while (len-- > 0 && simLineHead - simLineTail < SIMLINESIZE)
+        simLine[simLineHead++ % SIMLINESIZE] = *data++;
+}
+
+void simSendBreak(void)
+{
+    if (simLineHead == simLineTail)
+        simNextAt = CycleCount() + simCharCycles;
+    if (simLineHead - simLineTail < SIMLINESIZE)
+        simLine[simLineHead++ % SIMLINESIZE] = SIMBREAK;
+}
+
+void simSetRate(int rate)//the host goes to another rate, only once the line is idle
+{
+    simCharCycles = SIMCLOCK * 10 / baudValues[rate];
+}
+
+uint32_t simPending(void)//bytes written but not received yet
+{
+    return simLineHead - simLineTail;
+}
+
+static void simDeliver(void)//every character that has finished arriving goes through the interrupt
+{
+    while (simLineTail != simLineHead && (int32_t)(CycleCount() - simNextAt) >= 0)
+    {
+        uint16_t c = simLine[simLineTail++ % SIMLINESIZE];
+        uint32_t resets = stubUartResets, divider = simCharCycles / 10;//oversampled, 16 clocks a bit
+
+        if ((int32_t)(simResetAt - (simNextAt - simCharCycles)) >= 0 && (int32_t)(simNextAt - simResetAt) > 0)
+            simLost++;//the eUSCI was reset between its start bit and its stop bit
+        else if (c == SIMBREAK)
+            stubReceive(0, UCBRK | UCFE | UCRXERR);
+        else
+        {
+            if (simAfterBreak && (UCA0ABCTL & UCABDEN))//detection mode loads what it timed this one at
+            {
+                UCA0BRW = divider / 16;
+                UCA0MCTLW = (divider % 16) << 4 | UCOS16;
+            }
+            simArrivedAt[rxHead] = simNextAt;
+            stubReceive(c, 0);
+        }
+        simAfterBreak = c == SIMBREAK;
+        if (stubUartResets != resets)
+            simResetAt = simNextAt - 1;//the interrupt runs in the stop bit, before the next start bit
+        simNextAt += simCharCycles;
+    }
+}
+
+void simRun(uint32_t us)//runs the main loop for us microseconds of simulated time
+{
+    uint32_t end = CycleCount() + us * (SIMCLOCK / 1000000);
+
+    while ((int32_t)(end - CycleCount()) > 0)
+    {
+        uint16_t tail = rxTail, slot;
+        uint32_t before = CycleCount(), resets;
+
+        simDeliver();
+        resets = stubUartResets;
+        SchedulerStep();
+        if (stubUartResets != resets)
+            simResetAt = CycleCount();
+        for (slot = tail; slot != rxTail; slot = (slot + 1) % RXRINGSIZE)
+            if (before - simArrivedAt[slot] > simMaxRxAge)
+                simMaxRxAge = before - simArrivedAt[slot];
+        dwt.CYCCNT += SIMSTEPCYCLES + simByteCycles * (uint16_t)((rxTail - tail + RXRINGSIZE) % RXRINGSIZE);
+        simLogHistory();
+        if (CycleCount() - before == SIMSTEPCYCLES && simLineTail != simLineHead &&
+            (int32_t)(simNextAt - CycleCount()) > 0 && !UARTHasChar())//nothing to do until the next byte
+            dwt.CYCCNT = (int32_t)(simNextAt - end) < 0 ? simNextAt : end;
+    }
+    simDeliver();
+}
+
+int simRead(uint8_t *buf, int max)//what the firmware sent since the last read
+{
+    int n = stubTxLen < max ? stubTxLen : max;
+
+    memcpy(buf, stubTx, n);
+    memmove(stubTx, stubTx + n, stubTxLen - n);
+    stubTxLen -= n;
+    return n;
+}
+
+const char *simLogLine(uint32_t line)//the line-th line that went into the scrollback
+{
+    return line < simLogLines && line < SIMLOGLINES ? simLog[line] : 0;
+}
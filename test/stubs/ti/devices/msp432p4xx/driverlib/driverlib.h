@@ -0,0 +1,168 @@
+/*
+ * Host build stand-in for the TI driverlib header. Only what main.c and the
+ * LcdDriver headers use is declared, the definitions are in hal_stub.c and
+ * the registers are plain variables the tests can set.
+ */
+#ifndef DRIVERLIB_STUB_H
+#define DRIVERLIB_STUB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct { uint32_t selectClockSource; uint16_t clockPrescalar; uint8_t firstModReg; uint8_t secondModReg; uint32_t parity, msborLsbFirst, numberofStopBits, uartMode, overSampling; } eUSCI_UART_Config;
+typedef struct { uint32_t selectClockSource, clockSourceFrequency, desiredSpiClock; uint16_t msbFirst, clockPhase, clockPolarity, spiMode; } eUSCI_SPI_MasterConfig;
+#define EUSCI_A_UART_CLOCKSOURCE_SMCLK 0x80
+#define EUSCI_A_UART_NO_PARITY 0
+#define EUSCI_A_UART_LSB_FIRST 0
+#define EUSCI_A_UART_ONE_STOP_BIT 0
+#define EUSCI_A_UART_MODE 0
+#define EUSCI_A_UART_OVERSAMPLING_BAUDRATE_GENERATION 1
+#define EUSCI_A_UART_RECEIVE_INTERRUPT_FLAG 1
+#define EUSCI_A_UART_TRANSMIT_INTERRUPT_FLAG 2
+#define EUSCI_A_UART_RECEIVE_INTERRUPT 1
+#define EUSCI_A_UART_TRANSMIT_INTERRUPT 2
+#define EUSCI_A_UART_RECEIVE_ERRONEOUSCHAR_INTERRUPT 0x20
+#define EUSCI_A_UART_BREAKCHAR_INTERRUPT 0x10
+#define EUSCI_A0_BASE 0x40001000
+#define EUSCI_A1_BASE 0x40001400
+#define EUSCI_A2_BASE 0x40001800
+#define EUSCI_A3_BASE 0x40001C00
+#define EUSCI_B0_BASE 0x40002000
+#define EUSCI_B_SPI_CLOCKSOURCE_SMCLK 0x80
+#define EUSCI_B_SPI_MSB_FIRST 1
+#define EUSCI_B_SPI_PHASE_DATA_CAPTURED_ONFIRST_CHANGED_ON_NEXT 1
+#define EUSCI_B_SPI_CLOCKPOLARITY_INACTIVITY_LOW 0
+#define EUSCI_B_SPI_3PIN 0
+#define GPIO_PORT_P1 1
+#define GPIO_PORT_P2 2
+#define GPIO_PORT_P3 3
+#define GPIO_PORT_P5 5
+#define GPIO_PORT_P9 9
+#define GPIO_PIN0 1
+#define GPIO_PIN1 2
+#define GPIO_PIN2 4
+#define GPIO_PIN3 8
+#define GPIO_PIN4 16
+#define GPIO_PIN5 32
+#define GPIO_PIN6 64
+#define GPIO_PIN7 128
+#define GPIO_PRIMARY_MODULE_FUNCTION 1
+#define TIMER32_0_BASE 1
+#define TIMER32_1_BASE 2
+#define TIMER32_PRESCALER_1 0
+#define TIMER32_32BIT 1
+#define TIMER32_PERIODIC_MODE 0
+#define WDT_A_BASE 0
+#define INT_EUSCIA0 32
+#define INT_EUSCIA1 33
+#define INT_EUSCIA2 34
+#define INT_EUSCIA3 35
+#define INT_DMA_INT1 50
+#define INT_DMA_INT0 51
+bool UART_initModule(uint32_t, const eUSCI_UART_Config*);
+void UART_enableModule(uint32_t);
+void UART_disableModule(uint32_t);
+uint_fast8_t UART_getInterruptStatus(uint32_t, uint8_t);
+uint8_t UART_receiveData(uint32_t);
+void UART_transmitData(uint32_t, uint_fast8_t);
+void UART_enableInterrupt(uint32_t, uint_fast8_t);
+void UART_disableInterrupt(uint32_t, uint_fast8_t);
+void UART_clearInterruptFlag(uint32_t, uint_fast8_t);
+uint_fast8_t UART_getEnabledInterruptStatus(uint32_t);
+bool SPI_initMaster(uint32_t, const eUSCI_SPI_MasterConfig*);
+void SPI_enableModule(uint32_t);
+void GPIO_setAsPeripheralModuleFunctionInputPin(uint_fast8_t, uint_fast16_t, uint_fast8_t);
+void GPIO_setAsPeripheralModuleFunctionOutputPin(uint_fast8_t, uint_fast16_t, uint_fast8_t);
+void GPIO_setAsOutputPin(uint_fast8_t, uint_fast16_t);
+void GPIO_setAsInputPin(uint_fast8_t, uint_fast16_t);
+void GPIO_setOutputLowOnPin(uint_fast8_t, uint_fast16_t);
+void GPIO_setOutputHighOnPin(uint_fast8_t, uint_fast16_t);
+void GPIO_toggleOutputOnPin(uint_fast8_t, uint_fast16_t);
+uint8_t GPIO_getInputPinValue(uint_fast8_t, uint_fast16_t);
+void Timer32_initModule(uint32_t, uint32_t, uint32_t, uint32_t);
+void Timer32_setCount(uint32_t, uint32_t);
+void Timer32_startTimer(uint32_t, bool);
+uint32_t Timer32_getValue(uint32_t);
+void WDT_A_hold(uint32_t);
+void Interrupt_enableInterrupt(uint32_t);
+void Interrupt_disableInterrupt(uint32_t);
+void Interrupt_enableMaster(void);
+bool Interrupt_disableMaster(void);
+uint32_t CS_getMCLK(void);
+uint32_t CS_getSMCLK(void);
+void SysCtl_rebootDevice(void);
+/* registers */
+extern volatile uint16_t UCB0STATW, UCB0TXBUF, UCB0IFG, UCB0IE;
+extern volatile uint16_t UCA0STATW, UCA0RXBUF, UCA0TXBUF, UCA0IFG, UCA0IE, UCA0BRW, UCA0MCTLW, UCA0CTLW0, UCA0ABCTL;
+#define UCBUSY 1
+#define UCTXIFG 2
+#define UCRXIFG 1
+typedef struct { volatile uint32_t CTRL, CYCCNT; } DWT_Type;
+typedef struct { volatile uint32_t DEMCR; } CoreDebug_Type;
+DWT_Type *stubClock(void); extern CoreDebug_Type *CoreDebug;
+#define DWT (stubClock())
+#define DWT_CTRL_CYCCNTENA_Msk 1
+#define CoreDebug_DEMCR_TRCENA_Msk (1<<24)
+#define CRC16_MODE 0
+#define CRC32_MODE 1
+void CRC32_setSeed(uint32_t seed, uint_fast8_t crcType);
+void CRC32_set8BitData(uint8_t dataIn, uint_fast8_t crcType);
+uint32_t CRC32_getResult(uint_fast8_t crcType);
+uint32_t CRC32_getResultReversed(uint_fast8_t crcType);
+#define EUSCI_A_UART_AUTOMATIC_BAUDRATE_DETECTION_MODE 0x0600
+#define UCBRK 0x0008
+#define UCRXERR 0x0004
+#define UCPE 0x0010
+#define UCOE 0x0020
+#define UCFE 0x0040
+#define UCABDEN 0x0001
+#define UCSWRST 0x0001
+#define UCOS16 0x0001
+#define UCLISTEN 0x0080
+#define UCTXIE 0x0002
+typedef struct { volatile void *srcEndAddr; volatile void *dstEndAddr; volatile uint32_t control; volatile uint32_t spare; } DMA_ControlTable;
+#define DMA_CH0_EUSCIB0TX0 0x00000000
+#define DMA_CH1_EUSCIB0RX0 0x00000001
+#define UDMA_PRI_SELECT 0x00000000
+#define UDMA_ALT_SELECT 0x00000008
+#define UDMA_SIZE_8 0x00000000
+#define UDMA_SRC_INC_8 0x00000000
+#define UDMA_SRC_INC_NONE 0x0c000000
+#define UDMA_DST_INC_NONE 0xc0000000
+#define UDMA_ARB_1 0x00000000
+#define UDMA_MODE_BASIC 0x00000001
+#define UDMA_MODE_PINGPONG 0x00000003
+#define UDMA_MODE_STOP 0x00000000
+#define UDMA_ATTR_USEBURST 1
+#define UDMA_ATTR_ALTSELECT 2
+#define UDMA_ATTR_HIGH_PRIORITY 4
+#define UDMA_ATTR_REQMASK 8
+void DMA_enableModule(void);
+void DMA_setControlBase(void *controlTable);
+void DMA_assignChannel(uint32_t mapping);
+void DMA_disableChannelAttribute(uint32_t channelNum, uint32_t attr);
+void DMA_setChannelControl(uint32_t channelStructIndex, uint32_t control);
+void DMA_setChannelTransfer(uint32_t channelStructIndex, uint32_t mode, void *srcAddr, void *dstAddr, uint32_t transferSize);
+void DMA_enableChannel(uint32_t channelNum);
+void DMA_disableChannel(uint32_t channelNum);
+bool DMA_isChannelEnabled(uint32_t channelNum);
+uint32_t DMA_getChannelMode(uint32_t channelStructIndex);
+void DMA_requestSoftwareTransfer(uint32_t channel);
+void DMA_assignInterrupt(uint32_t interruptNumber, uint32_t channel);
+void DMA_enableInterrupt(uint32_t interruptNumber);
+void DMA_clearInterruptFlag(uint32_t intChannel);
+uint32_t DMA_getInterruptStatus(void);
+uint32_t SPI_getTransmitBufferAddressForDMA(uint32_t moduleInstance);
+#define DMA_INT1 INT_DMA_INT1
+#define FLASH_INFO_MEMORY_SPACE_BANK0 0x02
+#define FLASH_INFO_MEMORY_SPACE_BANK1 0x03
+#define FLASH_SECTOR0 0x00000001
+#define FLASH_SECTOR1 0x00000002
+bool FlashCtl_unprotectSector(uint_fast8_t memorySpace, uint32_t sectorMask);
+bool FlashCtl_protectSector(uint_fast8_t memorySpace, uint32_t sectorMask);
+bool FlashCtl_eraseSector(uintptr_t addr);//uintptr_t, stubInfo is wherever the host puts it
+extern uint8_t stubInfo[];//INFO flash, 0x200000 on the board
+#define SETTINGS_INFO ((uintptr_t)stubInfo)
+bool FlashCtl_programMemory(void *src, void *dest, uint32_t length);
+
+#endif /* DRIVERLIB_STUB_H */
@@ -0,0 +1,43 @@
+/*
+ * Host build stand-in for the TI graphics library header, the types and
+ * calls main.c uses. Drawing through it does nothing on the host, the text
+ * renderer writes to the panel model in hal_stub.c directly.
+ */
+#ifndef GRLIB_STUB_H
+#define GRLIB_STUB_H
+#include <stdint.h>
+#include <stdbool.h>
+typedef struct { int16_t sXMin, sYMin, sXMax, sYMax; } Graphics_Rectangle;
+typedef struct Graphics_Display { int32_t size; void *displayData; uint16_t width; uint16_t heigth; } Graphics_Display;
+typedef struct { void (*pfnPixelDraw)(const Graphics_Display*, int16_t, int16_t, uint16_t);
+ void (*pfnPixelDrawMultiple)(const Graphics_Display*, int16_t, int16_t, int16_t, int16_t, int16_t, const uint8_t*, const uint32_t*);
+ void (*pfnLineDrawH)(const Graphics_Display*, int16_t, int16_t, int16_t, uint16_t);
+ void (*pfnLineDrawV)(const Graphics_Display*, int16_t, int16_t, int16_t, uint16_t);
+ void (*pfnRectFill)(const Graphics_Display*, const Graphics_Rectangle*, uint16_t);
+ uint32_t (*pfnColorTranslate)(const Graphics_Display*, uint32_t);
+ void (*pfnFlush)(const Graphics_Display*);
+ void (*pfnClearDisplay)(const Graphics_Display*, uint16_t);} Graphics_Display_Functions;
+typedef struct { uint8_t format, maxWidth, height, baseline; uint16_t offset[96]; const uint8_t *data; } Graphics_Font;
+typedef struct { int32_t size; const Graphics_Display *display; const Graphics_Display_Functions *displayFuncs; Graphics_Rectangle clipRegion; uint32_t foreground, background; const Graphics_Font *font; } Graphics_Context;
+#define GRAPHICS_FONT_FMT_UNCOMPRESSED 0
+#define OPAQUE_TEXT 1
+#define GRAPHICS_COLOR_BLACK 0x000000
+#define GRAPHICS_COLOR_RED 0xFF0000
+#define GRAPHICS_COLOR_GREEN 0x008000
+#define GRAPHICS_COLOR_YELLOW 0xFFFF00
+#define GRAPHICS_COLOR_BLUE 0x0000FF
+#define GRAPHICS_COLOR_MAGENTA 0xFF00FF
+#define GRAPHICS_COLOR_CYAN 0x00FFFF
+#define GRAPHICS_COLOR_WHITE 0xFFFFFF
+extern const Graphics_Font g_sFontCmtt16, g_sFontFixed6x8;
+void Graphics_initContext(Graphics_Context*, const Graphics_Display*, const Graphics_Display_Functions*);
+void Graphics_setForegroundColor(Graphics_Context*, int32_t);
+void Graphics_setBackgroundColor(Graphics_Context*, int32_t);
+void Graphics_setForegroundColorTranslated(Graphics_Context*, uint16_t);
+void Graphics_setBackgroundColorTranslated(Graphics_Context*, uint16_t);
+void GrContextFontSet(Graphics_Context*, const Graphics_Font*);
+void Graphics_setFont(Graphics_Context*, const Graphics_Font*);
+void Graphics_clearDisplay(Graphics_Context*);
+void Graphics_drawString(Graphics_Context*, int8_t*, int32_t, int32_t, int32_t, bool);
+void Graphics_fillRectangle(Graphics_Context*, const Graphics_Rectangle*);
+#endif /* GRLIB_STUB_H */
@@ -0,0 +1,186 @@
+/*
+ * ANSI conformance: replays the recorded byte streams ansi/<name>.in and
+ * compares what is left on the pane with ansi/<name>.out. A stream whose name
+ * ends in _pane<n> is fed to pane n with all the panes on screen, the rest
+ * go to the console on its own. Everything runs in the dense 21x16 mode.
+ *
+ * The .out files hold the pane's text rows between bars, then the
+ * foreground and background color_t of every cell, then the cursor row and
+ * column within the pane. After the frame is drawn every cell on the panel
+ * has to show the same character in the same colors.
+ *
+ *   make -C test UPDATE=1  rewrites the .out files from what the firmware
+ *                          does now, check the diff before committing it
+ */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include "hal_stub.h"
+
+#define ANSIDIR "ansi/"
+#define MAXSTREAM 4096
+#define MAXDUMP 4096
+
+static int failures = 0;
+
+static int readFile(const char *path, char *buf, int size)
+{
+    FILE *f = fopen(path, "rb");
+    int n;
+
+    if (!f)
+        return -1;
+    n = fread(buf, 1, size - 1, f);
+    fclose(f);
+    buf[n] = 0;
+    return n;
+}
+
+static uint16_t cellPixel(const term_t *t, int color, bool isFg)
+{
+    if (color == custom)
+        return SWAP16(isFg ? t->customFgPixel : t->customBgPixel);
+    return SWAP16(colorTable[color]);
+}
+
+static int dumpPane(const term_t *t, char *out)
+{
+    int len = 0, row, col;
+
+    for (row = t->top; row < t->top + t->rows; row++)
+        len += sprintf(out + len, "|%.*s|\n", termCols, screenChars[row]);
+    for (row = t->top; row < t->top + t->rows; row++)
+    {
+        for (col = 0; col < termCols; col++)
+            out[len++] = '0' + (screenAttrs[row][col] & 0xF);
+        out[len++] = ' ';
+        for (col = 0; col < termCols; col++)
+            out[len++] = '0' + (screenAttrs[row][col] >> 4);
+        out[len++] = '\n';
+    }
+    len += sprintf(out + len, "cursor %d %d\n", t->rowNum - t->top, t->colNum);
+    return len;
+}
+
+static void checkPanel(const char *name, const term_t *t)//the panel shows what screenChars holds
+{
+    int row, col;
+
+    for (row = t->top; row < t->top + t->rows; row++)
+    {
+        for (col = 0; col < termCols; col++)
+        {
+            char c;
+            uint16_t fgPixel, bgPixel;
+            uint8_t attr = screenAttrs[row][col];
+
+            bool drawn = stubPanelCell(row, col, &c, &fgPixel, &bgPixel);
+            bool filled = !drawn && fgPixel == bgPixel;//erased cells are filled, not drawn as a space
+            if (filled ? screenChars[row][col] != ' ' || bgPixel != cellPixel(t, attr >> 4, false) :
+                c != screenChars[row][col] || fgPixel != cellPixel(t, attr & 0xF, true) || bgPixel != cellPixel(t, attr >> 4, false))
+            {
+                printf("FAIL %s: panel row %d col %d shows '%c' %04x on %04x, the screen has '%c' attr %02x\n",
+                       name, row, col, c, fgPixel, bgPixel, screenChars[row][col], attr);
+                failures++;
+                return;
+            }
+        }
+    }
+}
+
+static void replay(const char *name, bool update)
+{
+    char path[512], stream[MAXSTREAM], expected[MAXDUMP], actual[MAXDUMP];
+    const char *paneTag = strstr(name, "_pane");
+    int pane = paneTag ? atoi(paneTag + 5) : CONSOLE;
+    int len, actualLen;
+    const term_t *t;
+
+    snprintf(path, sizeof(path), ANSIDIR "%s.in", name);
+    len = readFile(path, stream, sizeof(stream));
+    if (len < 0 || pane < 0 || pane >= NUMPORTS)
+    {
+        printf("FAIL %s: can't read the stream\n", name);
+        failures++;
+        return;
+    }
+
+    InitTerms();
+    paneCount = paneTag ? NUMPORTS : 1;
+    LCDSetTermMode(termFixed6x8);
+    TermSelect(pane);
+    parseCommands((const uint8_t *)stream, len);
+    TermSelect(CONSOLE);
+    LCDRenderFrame();
+
+    t = &terms[pane];
+    actualLen = dumpPane(t, actual);
+    actual[actualLen] = 0;
+    checkPanel(name, t);
+
+    snprintf(path, sizeof(path), ANSIDIR "%s.out", name);
+    if (update)
+    {
+        FILE *f = fopen(path, "wb");
+        if (f)
+        {
+            fwrite(actual, 1, actualLen, f);
+            fclose(f);
+        }
+        printf("%s: updated\n", name);
+        return;
+    }
+    if (readFile(path, expected, sizeof(expected)) < 0 || strcmp(expected, actual) != 0)
+    {
+        printf("FAIL %s: expected\n%sgot\n%s", name, expected, actual);
+        failures++;
+        return;
+    }
+    printf("%s: ok\n", name);
+}
+
+static int byName(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+int main(void)
+{
+    DIR *dir = opendir(ANSIDIR);
+    struct dirent *entry;
+    char *names[256];
+    int count = 0, i;
+    bool update = getenv("UPDATE") && atoi(getenv("UPDATE"));
+
+    InitCycleCounter();
+    InitTerms();
+    InitCommands();
+    frameRate = 0;
+
+    while (dir && (entry = readdir(dir)) && count < 256)
+    {
+        size_t n = strlen(entry->d_name);
+        if (n > 3 && strcmp(entry->d_name + n - 3, ".in") == 0)
+            names[count++] = strndup(entry->d_name, n - 3);
+    }
+    if (dir)
+        closedir(dir);
+    qsort(names, count, sizeof(names[0]), byName);
+    for (i = 0; i < count; i++)
+    {
+        replay(names[i], update);
+        free(names[i]);
+    }
+
+    if (count == 0)
+    {
+        printf("FAIL: no streams in " ANSIDIR "\n");
+        failures++;
+    }
+    printf(failures ? "ansi: FAILED\n" : "ansi: ok, %d streams\n", count);
+    return failures != 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * Auto baud on EUSCI_A0, across the whole range a host could be sending at.
+ *
+ * The eUSCI is modelled the way its detection mode behaves: after a break
+ * it measures the next character and loads UCBRx and UCBRFx for the rate it
+ * saw, with no second modulation stage. For every host rate from well below
+ * 9600 to well above 57600 a break and a sync field have to end up on the
+ * table divider of the closest supported rate. A break followed by anything
+ * but a clean sync has to leave the port on the table divider it was on.
+ * Once the host is known to be on the same rate a break only resyncs, and
+ * a 'U' after it is data, until #a or a framing error arms auto baud again.
+ *
+ * Through sim.c, a host that streams right after a switch, made with #u or
+ * with a break and sync, must not lose a byte to the eUSCI being reset.
+ */
+#include "sim.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define SMCLK 3000000.0
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; return; } } while (0)
+
+static void measure(double hostRate)//what the eUSCI loads after timing a character at hostRate
+{
+    double n = SMCLK / hostRate;//oversampling, UCBRx is n / 16 and UCBRFx the sixteenths left over
+    UCA0BRW = (uint16_t)(n / 16);
+    UCA0MCTLW = ((uint16_t)n % 16) << 4 | UCOS16;
+}
+
+static bool onTable(UARTBaudRate_t rate)
+{
+    return UCA0BRW == baudBR[rate] && UCA0MCTLW == ((baudBRS[rate] << 8) | (baudBRF[rate] << 4) | UCOS16);
+}
+
+static void reset(UARTBaudRate_t rate)
+{
+    while (UARTHasChar())
+        UARTGetChar();
+    UARTClearBreak();
+    baudRate = rate;
+    baudAuto = false;
+    UARTLoadBaud(rate);
+    cmdAutoBaud(0);
+    stubTxLen = 0;
+}
+
+static bool announced(UARTBaudRate_t rate)
+{
+    char text[32];
+    int len = sprintf(text, "baud %u", (unsigned)baudValues[rate]), i;
+
+    for (i = 0; i + len <= stubTxLen; i++)
+        if (memcmp(stubTx + i, text, len) == 0)
+            return true;
+    return false;
+}
+
+static double distance(double hostRate, int rate)//how far the measured divider is from rate's
+{
+    return fabs(SMCLK / hostRate - baudDividers[rate]);
+}
+
+static UARTBaudRate_t closest(double hostRate, double *margin)//by divider, like the firmware
+{
+    int i, best = 0, second = 1;
+
+    for (i = 1; i < 4; i++)
+    {
+        if (distance(hostRate, i) < distance(hostRate, best))
+        {
+            second = best;
+            best = i;
+        }
+        else if (distance(hostRate, i) < distance(hostRate, second))
+            second = i;
+    }
+    *margin = distance(hostRate, second) - distance(hostRate, best);
+    return (UARTBaudRate_t)best;
+}
+
+static void sync(double hostRate)
+{
+    stubReceive(0, UCBRK | UCFE | UCRXERR);
+    measure(hostRate);
+    stubReceive(0x55, 0);
+}
+
+static void checkRate(double hostRate, UARTBaudRate_t expected)
+{
+    reset(expected == baud9600 ? baud57600 : baud9600);//always a change
+    sync(hostRate);
+
+    CHECK(onTable(expected), "%.0f baud: UCA0BRW %u UCA0MCTLW %04x, not the %u table divider",
+          hostRate, UCA0BRW, UCA0MCTLW, (unsigned)baudValues[expected]);
+    CHECK(!UARTHasChar(), "%.0f baud: the sync went into the ring", hostRate);
+    CHECK(UARTAutoBaud(), "%.0f baud: no sync seen", hostRate);
+    CHECK(baudRate == expected && baudAuto, "%.0f baud: took %u", hostRate, (unsigned)baudValues[baudRate]);
+    CHECK(onTable(expected) && announced(expected), "%.0f baud: not announced at %u", hostRate, (unsigned)baudValues[expected]);
+}
+
+static void testSupportedRates(void)//each supported rate, with the clock of either end 3% off
+{
+    int rate, tenths;
+
+    for (rate = baud9600; rate <= baud57600; rate++)
+        for (tenths = -30; tenths <= 30; tenths += 5)
+            checkRate(baudValues[rate] * (1 + tenths / 1000.0), (UARTBaudRate_t)rate);
+}
+
+static void testFullRange(void)//everything in between goes to the closest rate
+{
+    double hostRate;
+    int checked = 0;
+
+    for (hostRate = 7000; hostRate <= 75000 && !failures; hostRate += 50)
+    {
+        double margin;
+        UARTBaudRate_t expected = closest(hostRate, &margin);
+
+        if (margin < 2)//halfway between two dividers, the truncated measurement may go either way
+            continue;
+        checkRate(hostRate, expected);
+        checked++;
+    }
+    printf("full range: %d host rates\n", checked);
+}
+
+static void testNotASync(void)//a break followed by data never leaves the raw measurement behind
+{
+    uint8_t c;
+
+    reset(baud19200);
+    stubReceive(0, UCBRK | UCFE | UCRXERR);
+    measure(SMCLK / 117);//whatever 'A' measured as
+    stubReceive('A', 0);
+    CHECK(onTable(baud19200), "data after a break left UCA0BRW %u UCA0MCTLW %04x", UCA0BRW, UCA0MCTLW);
+    CHECK(UARTHasChar() && (c = UARTGetChar()) == 'A', "data after a break was not received");
+    CHECK(!UARTAutoBaud() && baudRate == baud19200, "data after a break changed the rate");
+
+    reset(baud38400);
+    stubReceive(0, UCBRK | UCFE | UCRXERR);
+    measure(9600);
+    stubReceive(0x55, UCFE | UCRXERR);//a sync with a framing error isn't one
+    CHECK(onTable(baud38400), "a broken sync left UCA0BRW %u UCA0MCTLW %04x", UCA0BRW, UCA0MCTLW);
+    CHECK(!UARTHasChar(), "a byte with a framing error went into the ring");
+    CHECK(!UARTAutoBaud() && baudRate == baud38400, "a broken sync changed the rate");
+
+    reset(baud57600);
+    stubReceive(0, UCBRK | UCFE | UCRXERR);
+    stubReceive(0, UCBRK | UCFE | UCRXERR);//a long break is seen twice
+    measure(19200);
+    stubReceive(0x55, 0);
+    CHECK(onTable(baud19200) && UARTAutoBaud() && baudRate == baud19200, "a long break and a sync didn't switch to 19200");
+}
+
+static void testResyncBreak(void)//a 'U' after a plain resync break is data
+{
+    reset(baud38400);
+    stubReceive('x', 0);//the host is on our rate
+    CHECK(UARTGetChar() == 'x', "data was not received");
+
+    stubReceive(0, UCBRK | UCFE | UCRXERR);
+    measure(SMCLK / 150);
+    stubReceive('U', 0);
+    CHECK(onTable(baud38400), "a 'U' after a resync break left UCA0BRW %u UCA0MCTLW %04x", UCA0BRW, UCA0MCTLW);
+    CHECK(UARTAtBreak(), "the break wasn't marked");
+    UARTClearBreak();
+    CHECK(UARTHasChar() && UARTGetChar() == 'U', "a 'U' after a resync break was dropped");
+    CHECK(!UARTAutoBaud() && baudRate == baud38400, "a 'U' after a resync break changed the rate");
+
+    stubReceive(0xF0, UCFE | UCRXERR);//the host went to another rate
+    sync(9600);
+    CHECK(UARTAutoBaud() && baudRate == baud9600 && onTable(baud9600), "a framing error didn't arm auto baud");
+
+    stubReceive('x', 0);
+    UARTGetChar();
+    parseCommands((const uint8_t *)"#a", 2);
+    sync(57600);
+    CHECK(UARTAutoBaud() && baudRate == baud57600 && onTable(baud57600), "#a didn't arm auto baud");
+}
+
+#define SWITCHLINES 200
+
+static void streamLines(void)
+{
+    char line[32];
+    int i, len;
+
+    for (i = 0; i < SWITCHLINES; i++)
+    {
+        len = sprintf(line, "L%04d switch\n", i);
+        simSend((const uint8_t *)line, len);
+    }
+    while (simPending())
+        simRun(10000);
+    simRun(100000);
+}
+
+static bool linesArrived(void)//each streamed line in the scrollback once, in order
+{
+    uint32_t i;
+    int next = 0;
+
+    for (i = 0; i < simLogLines; i++)
+        if (simLogLine(i)[0] == 'L' && atoi(simLogLine(i) + 1) == next)
+            next++;
+    return next == SWITCHLINES;
+}
+
+static void testSwitchStream(void)
+{
+    uint32_t overflows;
+    int waited;
+
+    simInit(baud9600, 0);//by hand: #u3, the host waits for the announcement and goes on at 57600
+    overflows = rxOverflows;
+    simSend((const uint8_t *)"#u3", 3);
+    for (waited = 0; waited < 1000 && !announced(baud57600); waited++)
+        simRun(1000);
+    CHECK(announced(baud57600) && onTable(baud57600), "#u3 didn't switch to 57600");
+    simSetRate(baud57600);
+    streamLines();
+    CHECK(simLost == 0 && rxOverflows == overflows, "#u3: %u bytes lost, %u dropped", (unsigned)simLost,
+          (unsigned)(rxOverflows - overflows));
+    CHECK(linesArrived(), "#u3: lines after the switch went missing");
+
+    simInit(baud57600, 0);//by auto baud: #a, then break, sync and the stream at 19200 without a pause
+    overflows = rxOverflows;
+    simSend((const uint8_t *)"#a", 2);
+    simRun(10000);
+    simSetRate(baud19200);
+    simSendBreak();
+    simSend((const uint8_t *)"U", 1);
+    streamLines();
+    CHECK(baudRate == baud19200 && onTable(baud19200) && announced(baud19200), "break and sync didn't switch to 19200");
+    CHECK(simLost == 0 && rxOverflows == overflows, "auto baud: %u bytes lost, %u dropped", (unsigned)simLost,
+          (unsigned)(rxOverflows - overflows));
+    CHECK(linesArrived(), "auto baud: lines after the sync went missing");
+}
+
+int main(void)
+{
+    InitCycleCounter();
+    InitTerms();
+    InitCommands();
+    InitUART();
+
+    testSupportedRates();
+    testFullRange();
+    testNotASync();
+    testResyncBreak();
+    testSwitchStream();
+
+    printf(failures ? "autobaud: FAILED\n" : "autobaud: ok\n");
+    return failures != 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * The #l loopback benchmark, run whole on the host. With UCLISTEN the stub
+ * eUSCI brings each byte the TX interrupt sends back to RX at the rate in
+ * the divider, and every read of the clock costs a few cycles, so the
+ * benchmark's own loop moves time on as it spins.
+ *
+ * With a free panel every rate gets all BENCHBYTES through with a latency,
+ * and the figures are printed. With a panel slow enough that a frame
+ * outlasts the RX ring, the bytes the ring couldn't take are the dropped
+ * count, the same as rxOverflows, and the latency is left out.
+ *
+ * #l runs inside parseCommands: whatever follows it in the same batch is
+ * still text, and echo and the baud rate are as before. Sent in a frame,
+ * #l does nothing and the frame is ACKed as usual.
+ */
+#include "sim.c"
+
+#include <stdio.h>
+
+#define CLOCKREAD 10 //cycles for one look at the clock, the benchmark loop does two or three a pass
+#define SLOWPANEL 20 //per byte on SPI, the panel falls behind the glyphs 38400 and up bring in
+#define RATES (baud57600 + 1)
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; return; } } while (0)
+
+typedef struct { unsigned baud, cps, drop, lat; bool hasLat; } result_t;
+
+static char out[STUBTXSIZE + 1];
+
+static const char *sent(void)//what went to the host, as a string
+{
+    memcpy(out, stubTx, stubTxLen);
+    out[stubTxLen] = 0;
+    return out;
+}
+
+//the results of each rate out of what went to the host
+static int readResults(result_t *results)
+{
+    const char *at;
+    int n = 0, used;
+
+    for (at = sent(); n < RATES && (at = strstr(at, "\r\n")) != NULL; at++)
+    {
+        result_t *r = &results[n];
+
+        if (sscanf(at, "\r\n%u %uc/s\r\ndrop %u lat %n", &r->baud, &r->cps, &r->drop, &used) != 3)
+            continue;
+        r->hasLat = sscanf(at + used, "%uus", &r->lat) == 1;
+        n++;
+    }
+    return n;
+}
+
+static void run(const char *text, uint32_t blitCycles)
+{
+    simInit(baud9600, blitCycles);
+    stubClockStep = CLOCKREAD;
+    parseCommands((const uint8_t *)text, strlen(text));
+    stubClockStep = 0;
+}
+
+static void testFree(void)
+{
+    result_t results[RATES];
+    int i, n;
+
+    run("#l0", 0);
+    n = readResults(results);
+    CHECK(n == RATES, "%d results, not %d", n, RATES);
+    for (i = 0; i < n; i++)
+    {
+        printf("%6u baud: %4u c/s, latency %4u us, line %4u c/s\n", results[i].baud, results[i].cps,
+               results[i].lat, results[i].baud / 10);
+        CHECK(results[i].baud == baudValues[i], "result %d is for %u baud", i, results[i].baud);
+        CHECK(results[i].drop == 0, "%u dropped at %u baud", results[i].drop, results[i].baud);
+        CHECK(results[i].hasLat, "no latency at %u baud", results[i].baud);
+        CHECK(results[i].cps > results[i].baud / 10 * 9 / 10 && results[i].cps <= results[i].baud / 10 * 101 / 100,
+              "%u c/s at %u baud", results[i].cps, results[i].baud);
+    }
+}
+
+static void testDrops(void)
+{
+    result_t results[RATES];
+    uint32_t overflows, dropped = 0;
+    int i, n;
+
+    overflows = rxOverflows;
+    run("#l0", SLOWPANEL);
+    n = readResults(results);
+    CHECK(n == RATES, "%d results, not %d", n, RATES);
+    for (i = 0; i < n; i++)
+    {
+        printf("%6u baud, slow panel: %4u dropped\n", results[i].baud, results[i].drop);
+        CHECK(results[i].hasLat == (results[i].drop == 0), "latency given with %u dropped", results[i].drop);
+        dropped += results[i].drop;
+    }
+    CHECK(results[RATES - 1].drop > 0, "nothing dropped at %u baud with a slow panel", results[RATES - 1].baud);
+    CHECK(dropped == rxOverflows - overflows, "%u reported dropped, the ring overflowed %u times",
+          (unsigned)dropped, (unsigned)(rxOverflows - overflows));
+}
+
+static void testInBatch(void)//every pattern, with text after it in the batch
+{
+    char text[] = "#l0after";
+    int row, pattern;
+
+    for (pattern = 0; pattern < NUMPATTERNS; pattern++)
+    {
+        text[2] = '0' + pattern;
+        run(text, 0);
+        row = term->rowNum;
+        CHECK(term->presentState == idle, "pattern %d: the parser is left in state %d", pattern, term->presentState);
+        CHECK(uartEcho, "pattern %d: echo is off", pattern);
+        CHECK(baudRate == baud9600, "pattern %d: left at %s baud", pattern, baudNames[baudRate]);
+        CHECK(!(UCA0STATW & UCLISTEN) && !(UCA0IE & UCTXIE), "pattern %d: still in loopback", pattern);
+        CHECK(memcmp(screenChars[row], "after", 5) == 0, "pattern %d: what followed #l wasn't taken as text", pattern);
+    }
+}
+
+static int slip(uint8_t *out, const uint8_t *in, int len)
+{
+    int n = 0, i;
+
+    out[n++] = SLIP_END;
+    for (i = 0; i < len; i++)
+    {
+        if (in[i] == SLIP_END || in[i] == SLIP_ESC)
+        {
+            out[n++] = SLIP_ESC;
+            out[n++] = in[i] == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC;
+        }
+        else
+            out[n++] = in[i];
+    }
+    out[n++] = SLIP_END;
+    return n;
+}
+
+static void testFramed(void)
+{
+    uint8_t frame[9] = {0, FRAMETEXT, '#', 'l', '0'}, line[2 * sizeof(frame) + 2];
+    uint32_t crc, start;
+    int len;
+
+    crc = crc32(frame, 5);
+    frame[5] = crc;
+    frame[6] = crc >> 8;
+    frame[7] = crc >> 16;
+    frame[8] = crc >> 24;
+    len = slip(line, frame, sizeof(frame));
+
+    run("#y1", 0);
+    stubTxLen = 0;
+    start = CycleCount();
+    stubClockStep = CLOCKREAD;
+    parseCommands(line, len);
+    stubClockStep = 0;
+    CHECK(term->presentState == framed, "left framed mode");
+    CHECK(!uartEcho, "echo back on in framed mode");
+    CHECK(CycleCount() - start < BENCHQUIET, "#l ran from a frame");
+    CHECK(stubTxLen > 0 && strstr(sent(), "c/s") == NULL, "results in the middle of the frames");
+}
+
+int main(void)
+{
+    testFree();
+    testDrops();
+    testInBatch();
+    testFramed();
+
+    printf(failures ? "bench: FAILED\n" : "bench: ok\n");
+    return failures != 0;
+}
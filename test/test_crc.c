@@ -0,0 +1,159 @@
+/*
+ * The framed mode CRC against other ways of computing CRC-32 on the host.
+ *
+ * crc32Software (the firmware's 16 entry table, 4 bits a step), a 256 entry
+ * byte table like zlib's, plain bit by bit and the CRC32 module model have
+ * to agree on the check value and on random frames of every length a frame
+ * can have. Then each one's throughput on this machine is printed next to
+ * what the line can carry, for comparison with the target figures #p gives
+ * (crc hw and sw, cycles for 256 bytes at MCLK). The host figures are with
+ * the sanitizers on, so only the ratios between them mean much.
+ */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "hal_stub.h"
+
+#define BENCHLEN 256 //one frame's payload, like the #p figures
+#define CRCBENCHBYTES (16u << 20)
+
+static int failures = 0;
+static uint32_t byteTable[256];
+
+static uint32_t crc32Bitwise(const uint8_t *data, int len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    int k;
+
+    while (len--)
+    {
+        crc ^= *data++;
+        for (k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+static uint32_t crc32ByteTable(const uint8_t *data, int len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (len--)
+        crc = (crc >> 8) ^ byteTable[(crc ^ *data++) & 0xFF];
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void initByteTable(void)
+{
+    uint32_t crc;
+    int i, k;
+
+    for (i = 0; i < 256; i++)
+    {
+        crc = i;
+        for (k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        byteTable[i] = crc;
+    }
+}
+
+typedef struct {
+    const char *name;
+    uint32_t (*crc)(const uint8_t *data, int len);
+} crcImpl_t;
+
+static const crcImpl_t impls[] = {
+    {"nibble table (firmware)", crc32Software},
+    {"byte table", crc32ByteTable},
+    {"bitwise", crc32Bitwise},
+    {"CRC32 module model", crc32Hardware},
+};
+#define NUMIMPLS (int)(sizeof(impls) / sizeof(impls[0]))
+
+static void testAgree(void)
+{
+    uint8_t data[FRAMEMAX];
+    int i, len, run;
+
+    for (i = 0; i < NUMIMPLS; i++)
+    {
+        if (impls[i].crc((const uint8_t *)"123456789", 9) != CRC32_CHECK)
+        {
+            printf("FAIL: %s gives %08x for \"123456789\"\n", impls[i].name, impls[i].crc((const uint8_t *)"123456789", 9));
+            failures++;
+        }
+    }
+    srand(1);
+    for (run = 0; run < 20 && !failures; run++)
+    {
+        for (len = 0; len <= FRAMEMAX && !failures; len++)
+        {
+            for (i = 0; i < len; i++)
+                data[i] = rand();
+            for (i = 1; i < NUMIMPLS; i++)
+            {
+                if (impls[i].crc(data, len) != impls[0].crc(data, len))
+                {
+                    printf("FAIL: %s and %s differ on %d bytes\n", impls[i].name, impls[0].name, len);
+                    failures++;
+                }
+            }
+        }
+    }
+    if (!crcHardware)
+    {
+        printf("FAIL: the module model didn't pass the start up check\n");
+        failures++;
+    }
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void benchmark(void)
+{
+    uint8_t data[BENCHLEN];
+    volatile uint32_t sink = 0;
+    double line = baudValues[baud57600] / 10.0;//bytes a second at the top rate
+    int i;
+    uint32_t done;
+
+    for (i = 0; i < BENCHLEN; i++)
+        data[i] = i * 7 + 1;
+    printf("host, %d byte frames, against %.0f bytes/s on the line at %u baud:\n", BENCHLEN, line, (unsigned)baudValues[baud57600]);
+    for (i = 0; i < NUMIMPLS; i++)
+    {
+        double start = seconds(), rate;
+
+        for (done = 0; done < CRCBENCHBYTES; done += BENCHLEN)
+            sink ^= impls[i].crc(data, BENCHLEN);
+        rate = CRCBENCHBYTES / (seconds() - start);
+        printf("  %-24s %8.1f MB/s, %6.0fx the line\n", impls[i].name, rate / 1e6, rate / line);
+    }
+    printf("target: keeps up with the line under %u cycles for %d bytes, compare crc hw and sw in #p\n",
+           (unsigned)(CYCLES_PER_MS * 1000 / line * BENCHLEN), BENCHLEN);
+    (void)sink;
+}
+
+int main(void)
+{
+    InitCycleCounter();
+    InitCRC32();
+    initByteTable();
+
+    testAgree();
+    if (!failures)
+        benchmark();
+
+    printf(failures ? "crc: FAILED\n" : "crc: ok\n");
+    return failures != 0;
+}
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""Soak tests of framed mode: tools/framed_send.py against the firmware.
+
+The firmware runs in build/libsim.so (sim.c), with the RX interrupt fed at
+57600 baud whatever the main loop is busy with. Each byte costs more to
+parse and draw than it takes on the line, so the firmware can't keep up. The sender streams thousands of
+numbered lines in the dense 21x16 mode. Its credit has to keep the RX ring
+from ever filling, and every line has to reach the scrollback exactly once
+and in order. The same frames sent back to back without waiting for credit
+have to overflow the ring, or the soak proves nothing.
+
+A noisy line flips and drops bytes both ways. Frames with a bad CRC are
+NAKed, lost replies run into the timeout, and go-back-N has to deliver
+every line exactly once and in order all the same.
+"""
+
+import ctypes
+import os
+import random
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, '..', 'tools'))
+import framed_send  # noqa: E402
+
+BAUD57600 = 3  # UARTBaudRate_t
+SLOWBLIT = 20  # cycles per byte sent to the panel
+SLOWBYTE = 700  # cycles to take a byte out of the ring, parse it and draw it, 520 is one byte time
+LINES = 5000
+NOCREDITLINES = 500
+STEPUS = 200  # simulated time per poll of the link
+NOISE = 1.0 / 3000  # chance of each byte being flipped, and again of it being dropped
+
+sim = ctypes.CDLL(os.path.join(HERE, 'build', 'libsim.so'))
+sim.simLogLine.restype = ctypes.c_char_p
+failures = 0
+
+
+def counter(name):
+    return ctypes.c_uint32.in_dll(sim, name).value
+
+
+class SimLink:
+    """The sender's end of the simulated UART, time only moves while it reads."""
+
+    def write(self, data):
+        sim.simSend(data, len(data))
+
+    def read(self, timeout):
+        buf = ctypes.create_string_buffer(4096)
+        waited = 0
+        while waited < timeout * 1e6:
+            sim.simRun(STEPUS)
+            waited += STEPUS
+            n = sim.simRead(buf, len(buf))
+            if n:
+                return buf.raw[:n]
+        return b''
+
+
+class NoisyLink:
+    """A SimLink with a bad line, in both directions."""
+
+    def __init__(self, link, seed):
+        self.link = link
+        self.random = random.Random(seed)
+        self.quiet = False
+        self.flipped = self.dropped = 0
+
+    def garble(self, data):
+        out = bytearray()
+        for b in data:
+            if self.quiet:
+                out.append(b)
+            elif self.random.random() < NOISE:
+                self.dropped += 1
+            elif self.random.random() < NOISE:
+                out.append(b ^ 1 << self.random.randrange(8))
+                self.flipped += 1
+            else:
+                out.append(b)
+        return bytes(out)
+
+    def write(self, data):
+        self.link.write(self.garble(data))
+
+    def read(self, timeout):
+        return self.garble(self.link.read(timeout))
+
+
+def numbered_lines(lines):
+    return b''.join(b'L%05d abcdefghijklm\n' % i for i in range(lines)) + b'\n' * 20  # the last lines scroll off too
+
+
+def logged_lines():
+    seen = []
+    for i in range(counter('simLogLines')):
+        line = sim.simLogLine(i)
+        if line and line.startswith(b'L'):
+            seen.append(int(line[1:6]))
+    return seen
+
+
+def check(cond, message):
+    global failures
+    if not cond:
+        print('FAIL ' + message)
+        failures += 1
+
+
+def boot():
+    sim.simInit(BAUD57600, SLOWBLIT)
+    ctypes.c_uint32.in_dll(sim, 'simByteCycles').value = SLOWBYTE
+    return counter('rxOverflows')
+
+
+def soak(link=None):
+    overflows = boot()
+    link = link or SimLink()
+    sender = framed_send.Sender(link, timeout=0.2, poll=0.002)
+    SimLink().write(b'#y1')  # the switch itself isn't framed, so it goes on a clean line
+    seq = sender.send(framed_send.text_frames(numbered_lines(LINES)))
+    link.quiet = True  # a repeated EXIT would land in the text parser once the board has left framed mode
+    sender.finish(seq)
+    sim.simRun(100000)
+    return sender, counter('rxOverflows') - overflows
+
+
+def blast():
+    """Bytes dropped with the frames sent back to back, without any credit."""
+    overflows = boot()
+    SimLink().write(b'#y1')
+    for seq, (op, payload) in enumerate(framed_send.text_frames(numbered_lines(NOCREDITLINES))):
+        SimLink().write(framed_send.slip_encode(framed_send.make_frame(seq, op, payload)))
+    while sim.simPending():
+        sim.simRun(100000)
+    sim.simRun(500000)
+    return counter('rxOverflows') - overflows
+
+
+def main():
+    sender, dropped = soak()
+    seen = logged_lines()
+    print('with credit: %d frames, %d sent again, %d bytes dropped, %d lines' %
+          (sender.frames_sent, sender.retransmits, dropped, len(seen)))
+    check(dropped == 0, 'the RX ring overflowed with the credit kept to')
+    check(sender.retransmits == 0, 'frames were sent again on a clean line')
+    check(seen == list(range(LINES)), 'lines lost, run twice or out of order')
+
+    dropped = blast()
+    print('without credit: %d bytes dropped' % dropped)
+    check(dropped > 0, 'the ring never overflowed without the credit, the soak is too easy')
+
+    noisy = NoisyLink(SimLink(), 1)
+    bad = counter('framesBad')
+    sender, dropped = soak(noisy)
+    bad = counter('framesBad') - bad
+    print('noisy line: %d bytes flipped, %d dropped, %d frames bad, %d NAKs, %d timeouts, %d frames sent again' %
+          (noisy.flipped, noisy.dropped, bad, sender.naks, sender.timeouts, sender.retransmits))
+    check(bad > 0 and sender.naks > 0 and sender.timeouts > 0, 'the noise never reached the CRC, the NAKs or the timeout')
+    check(dropped == 0, 'the RX ring overflowed on the noisy line')
+    check(logged_lines() == list(range(LINES)), 'lines lost, run twice or out of order on the noisy line')
+
+    print('framed: FAILED' if failures else 'framed: ok')
+    return failures != 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,169 @@
+/*
+ * Paging through the scrollback a slice at a time while text keeps coming.
+ *
+ * LCDHistoryStep redraws the console rows a few runs per call, so the panel
+ * is a mix of the old view and the new one for a while, and LCDRenderFrame
+ * runs in between with whatever text was parsed. Random pages, random step
+ * budgets and text written at random places go through in a random order.
+ * Whenever the view is back on the live screen and every row has caught up,
+ * each console cell on the panel has to show what screenChars holds.
+ *
+ * Text is written with cursor moves and no line feeds: a new scrollback line
+ * would move what an older view shows, which rxRun avoids by going back to
+ * the live screen before any text is parsed.
+ *
+ * A row goes into the scrollback whole when the cursor leaves it, whatever
+ * column the line feed came in, and less its trailing blanks.
+ */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "hal_stub.h"
+
+#define RUNS 3000
+
+static int failures = 0;
+
+static uint16_t cellPixel(int color, bool isFg)
+{
+    const term_t *t = &terms[CONSOLE];
+
+    if (color == custom)
+        return SWAP16(isFg ? t->customFgPixel : t->customBgPixel);
+    return SWAP16(colorTable[color]);
+}
+
+static bool panelMatches(int run)
+{
+    const term_t *t = &terms[CONSOLE];
+    int row, col;
+
+    for (row = t->top; row < t->top + t->rows; row++)
+    {
+        for (col = 0; col < termCols; col++)
+        {
+            char c;
+            uint16_t fgPixel, bgPixel;
+            uint8_t attr = screenAttrs[row][col];
+            bool drawn = stubPanelCell(row, col, &c, &fgPixel, &bgPixel);
+            bool filled = !drawn && fgPixel == bgPixel;//erased cells are filled, not drawn as a space
+            bool unseen = cellPixel(attr & 0xF, true) == cellPixel(attr >> 4, false);//text in the background color
+
+            if (filled ? (screenChars[row][col] != ' ' && !unseen) || bgPixel != cellPixel(attr >> 4, false) :
+                c != screenChars[row][col] || fgPixel != cellPixel(attr & 0xF, true) || bgPixel != cellPixel(attr >> 4, false))
+            {
+                printf("FAIL run %d: panel row %d col %d shows '%c', the screen has '%c'\n", run, row, col, c, screenChars[row][col]);
+                failures++;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void writeText(void)//a few characters somewhere on the console, in random colors now and then
+{
+    char text[48];
+    int len = sprintf(text, "\x1b[%d;%dH", 1 + rand() % terms[CONSOLE].rows, 1 + rand() % (termCols - 4));
+
+    if (rand() % 4 == 0)
+        len += sprintf(text + len, "\x1b[3%dm", rand() % 8);
+    len += sprintf(text + len, "%c%c%c", 'a' + rand() % 26, 'A' + rand() % 26, '0' + rand() % 10);
+    parseCommands((const uint8_t *)text, len);
+}
+
+static void testPaging(void)
+{
+    int run, i, settled = 0;
+    char line[32];
+
+    srand(1);
+    InitTerms();
+    paneCount = 1;
+    LCDSetTermMode(termFixed6x8);
+    for (i = 0; i < 80; i++)//scrollback to page through
+    {
+        int len = sprintf(line, "line %d\n", i);
+        parseCommands((const uint8_t *)line, len);
+    }
+    LCDRenderFrame();
+    stubBlitCycles = 1;//so a step budget runs out partway
+
+    for (run = 0; run < RUNS && !failures; run++)
+    {
+        switch (rand() % 5)
+        {
+        case 0:
+            LCDPageHistory(rand() % 3 ? 1 : -1);
+            break;
+        case 1:
+            LCDShowHistory(0);
+            break;
+        case 2:
+            LCDHistoryStep(rand() % 3000);
+            break;
+        case 3:
+            writeText();
+            break;
+        case 4:
+            LCDRenderFrame();
+            break;
+        }
+        if (historyView == 0 && rand() % 8 == 0)//settle and look
+        {
+            while (!LCDHistoryStep(rand() % 3000))
+                ;
+            LCDRenderFrame();
+            if (panelMatches(run))
+                settled++;
+        }
+    }
+    printf("paging: %d runs, %d times back on the live screen\n", run, settled);
+}
+
+static void testLineSaved(void)
+{
+    static const struct {
+        const char *text, *saved;
+    } lines[] = {
+        {"abcdef\rxy\n", "xycdef"},//overwritten at the start, the rest stays
+        {"abcdef\r\n", "abcdef"},
+        {"short\n", "short"},
+        {"  lead\n", "  lead"},
+    };
+    int i, slot;
+    char expect[MAXCOLS + 1];
+
+    InitTerms();
+    paneCount = 1;
+    LCDSetTermMode(termFixed6x8);
+    historyCount = historyNext = 0;
+    for (i = 0; i < (int)(sizeof(lines) / sizeof(lines[0])); i++)
+    {
+        parseCommands((const uint8_t *)lines[i].text, strlen(lines[i].text));
+        slot = (historyNext - 1 + SCROLLBACK_LINES) % SCROLLBACK_LINES;
+        snprintf(expect, sizeof(expect), "%-*s", MAXCOLS, lines[i].saved);
+        if (memcmp(historyChars[slot], expect, MAXCOLS) != 0)
+        {
+            printf("FAIL: \"%s\" saved as \"%.*s\"\n", lines[i].saved, MAXCOLS, historyChars[slot]);
+            failures++;
+        }
+    }
+}
+
+int main(void)
+{
+    InitCycleCounter();
+    InitTerms();
+    InitCommands();
+    frameRate = 0;
+
+    testPaging();
+    testLineSaved();
+
+    printf(failures ? "history: FAILED\n" : "history: ok\n");
+    return failures != 0;
+}
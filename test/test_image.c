@@ -0,0 +1,157 @@
+/*
+ * #i raw RGB565 uploads through sim.c, at each baud rate the UART has.
+ *
+ * The pixels arrive at the line rate through the RX interrupt and go to the
+ * panel window as they come, so the stubPanel has to hold the image pixel
+ * for pixel afterwards, with nothing written outside the window and no byte
+ * dropped. The pixels a second are the board's own figure, the one #p
+ * shows, printed next to what the line can carry.
+ *
+ * An upload cut into odd pieces, with text drawn on the status row between
+ * them, has to come out the same: each time the window is taken away the
+ * rest of the row goes out in a window of its own. A window that doesn't
+ * fit on the panel cancels the upload, and what follows is text.
+ */
+#include "sim.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PANELCYCLES 3 //per byte on SPI, about what the panel takes at MCLK
+#define IMAGEX 16
+#define IMAGEY 32
+#define IMAGEW 96
+#define IMAGEH 64
+#define UPLOADMAX (2 + 4 + 128 * 128 * 2)
+
+static int failures = 0;
+static uint8_t upload[UPLOADMAX];
+static uint16_t before[128][128];
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; return; } } while (0)
+
+static uint16_t testPixel(int x, int y)//has '#', ESC and SLIP bytes in it, which must not be taken as anything
+{
+    return (uint16_t)(x * 2047 + y * 131 + 0x23C0);
+}
+
+static int makeUpload(int x, int y, int w, int h)
+{
+    int len = 0, px, py;
+
+    upload[len++] = '#';
+    upload[len++] = 'i';
+    upload[len++] = x;
+    upload[len++] = y;
+    upload[len++] = w;
+    upload[len++] = h;
+    for (py = 0; py < h; py++)
+    {
+        for (px = 0; px < w; px++)
+        {
+            upload[len++] = testPixel(px, py) >> 8;
+            upload[len++] = testPixel(px, py) & 0xFF;
+        }
+    }
+    return len;
+}
+
+static bool panelHolds(int x, int y, int w, int h)//the image in its window, the text rows as they were before
+{
+    int px, py;
+
+    for (py = terms[CONSOLE].top * FIXED_CELL_HEIGHT; py < 128; py++)//the status rows keep counting
+    {
+        for (px = 0; px < 128; px++)
+        {
+            bool inside = px >= x && px < x + w && py >= y && py < y + h;
+            uint16_t expect = inside ? testPixel(px - x, py - y) : before[py][px];
+
+            if (stubPanel[py][px] != expect)
+            {
+                printf("FAIL: panel pixel %d,%d is %04x, %04x %s\n", px, py, stubPanel[py][px], expect,
+                       inside ? "in the image" : "was there before");
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void testRates(void)
+{
+    int rate, len = makeUpload(IMAGEX, IMAGEY, IMAGEW, IMAGEH);
+    uint32_t overflows;
+
+    for (rate = baud9600; rate <= baud57600; rate++)
+    {
+        simInit(rate, PANELCYCLES);
+        simRun(100000);//the boot screen goes out first
+        memcpy(before, stubPanel, sizeof(before));
+        overflows = rxOverflows;
+        simSend(upload, len);
+        while (simPending() || term->presentState != idle)
+            simRun(10000);
+        simRun(100000);
+
+        printf("%s baud: %u pixels in %u ms, %u px/s, the line carries %u px/s\n", baudNames[rate],
+               (unsigned)imagePixels, (unsigned)(imageCycles / CYCLES_PER_MS),
+               (unsigned)((uint64_t)imagePixels * SIMCLOCK / imageCycles), (unsigned)(baudValues[rate] / 20));
+        CHECK(imagePixels == IMAGEW * IMAGEH, "the upload didn't finish");
+        CHECK(rxOverflows == overflows, "%u bytes dropped", (unsigned)(rxOverflows - overflows));
+        CHECK(panelHolds(IMAGEX, IMAGEY, IMAGEW, IMAGEH), "the image isn't on the panel at %s baud", baudNames[rate]);
+    }
+}
+
+static void testPartialRows(void)
+{
+    static const int x = 3, y = 41, w = 37, h = 11;//odd width, so pieces end mid pixel and mid row
+    int len = makeUpload(x, y, w, h), sent = 0, piece, run;
+    uint16_t fg = 0xFFFF, bg = 0;
+
+    for (run = 0; run < 20; run++)
+    {
+        simInit(baud57600, 0);
+        memcpy(before, stubPanel, sizeof(before));
+        srand(run);
+        for (sent = 0; sent < len; sent += piece)
+        {
+            piece = 1 + rand() % 37;
+            if (piece > len - sent)
+                piece = len - sent;
+            parseCommands(upload + sent, piece);
+            if (rand() % 2)//the status row draws and takes the window away
+                LCDDrawCells(0, rand() % 16, "x", &fg, &bg, 1);
+        }
+        CHECK(term->presentState == idle, "run %d: the upload didn't finish", run);
+        CHECK(panelHolds(x, y, w, h), "run %d: the image isn't on the panel", run);
+    }
+}
+
+static void testOffPanel(void)
+{
+    static const uint8_t windows[][4] = {{100, 0, 40, 8}, {0, 125, 8, 4}, {0, 0, 0, 8}, {0, 0, 8, 0}};
+    char text[] = "after";
+    int i, row;
+
+    for (i = 0; i < (int)(sizeof(windows) / sizeof(windows[0])); i++)
+    {
+        simInit(baud57600, 0);
+        row = term->rowNum;
+        parseCommands((const uint8_t *)"#i", 2);
+        parseCommands(windows[i], 4);
+        parseCommands((const uint8_t *)text, 5);
+        CHECK(term->presentState == idle, "window %d: still in the upload", i);
+        CHECK(memcmp(screenChars[row], text, 5) == 0, "window %d: what followed wasn't taken as text", i);
+    }
+}
+
+int main(void)
+{
+    testRates();
+    testPartialRows();
+    testOffPanel();
+
+    printf(failures ? "image: FAILED\n" : "image: ok\n");
+    return failures != 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * Fuzz test of the table driven '#' command parser and the ANSI escape
+ * parser. Random and truncated sequences go through parseCommands, and
+ * after every byte the parser state has to be one the firmware can be in:
+ * commandText never written past MAXCOMMANDLEN, the match range inside
+ * commandTable. Whatever was fed, a newline brings the parser back to text.
+ * The same input fed in one batch and a byte at a time has to leave the
+ * same screen behind.
+ *
+ * commandText sits inside term_t, so a write past it would land in
+ * commandLen and be caught by the checks, and the address sanitizer catches
+ * anything past the end of terms[].
+ */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "hal_stub.h"
+
+#define FUZZRUNS 20000
+#define MAXFUZZLEN 48
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; return; } } while (0)
+
+static char lastInput[MAXFUZZLEN * 2 + 1];//shown when a check fails
+
+static void checkState(void)
+{
+    const term_t *t = &terms[CONSOLE];
+
+    CHECK(term == t, "parsing moved off the console after \"%s\"", lastInput);
+    CHECK(t->commandLen >= 0 && t->commandLen <= MAXCOMMANDLEN, "commandLen %d after \"%s\"", t->commandLen, lastInput);
+    CHECK(t->presentState <= csi, "state %d after \"%s\"", t->presentState, lastInput);
+    if (t->presentState == opcode || t->presentState == argument)
+    {
+        CHECK(t->commandLen >= 1 && t->commandText[0] == '#', "commandText lost its '#' after \"%s\"", lastInput);
+        CHECK(t->firstMatch >= 0 && t->firstMatch <= t->lastMatch && t->lastMatch < NUMCOMMANDS,
+              "match range %d..%d after \"%s\"", t->firstMatch, t->lastMatch, lastInput);
+        CHECK(t->opcodeLen <= (int)strlen(commandTable[t->firstMatch].opcode), "opcodeLen %d after \"%s\"", t->opcodeLen, lastInput);
+        CHECK(t->matched == 0 || (t->matched >= commandTable && t->matched < commandTable + NUMCOMMANDS),
+              "matched outside commandTable after \"%s\"", lastInput);
+    }
+    CHECK(t->presentState != argument || t->matched, "argument state without a command after \"%s\"", lastInput);
+}
+
+static void resetTerminal(void)
+{
+    InitTerms();
+    paneCount = 1;
+    LCDSetTermMode(termFixed6x8);
+    LCDRenderFrame();
+    stubTxLen = 0;
+}
+
+static int randomSequence(char *out, const char *alphabet)
+{
+    static const char *const pieces[] = {//whole commands, cut short below
+        "#f3", "#b4", "#fc12aB3f", "#bc00ff00", "#x", "##", "# ", "#m1", "#r30;", "#r0;",
+        "#s12;", "#s0;", "#s000000000000000000012;", "#r00000000000000000000009;", "#w1", "#u2", "#e", "#t2", "#t1",
+        "\x1b[2;5H", "\x1b[1;31;44m", "\x1b[m", "\x1b[0K", "\x1b[2J", "\x1b[3A", "\x1b[s", "\x1b[u", "\x1b" "7", "\x1b" "8",
+    };
+    int len = 0, n = rand() % MAXFUZZLEN;
+
+    while (len < n)
+    {
+        if (rand() % 3 == 0)
+        {
+            const char *p = pieces[rand() % (int)(sizeof(pieces) / sizeof(pieces[0]))];
+            int cut = 1 + rand() % (int)strlen(p);//a truncated command most of the time
+            while (cut-- && len < MAXFUZZLEN)
+                out[len++] = *p++;
+        }
+        else
+            out[len++] = alphabet[rand() % (int)strlen(alphabet)];
+    }
+    out[len] = 0;
+    return len;
+}
+
+static void feed(const char *in, int len, bool byteAtATime)
+{
+    int i;
+
+    if (!byteAtATime)
+    {
+        parseCommands((const uint8_t *)in, len);
+        checkState();
+        return;
+    }
+    for (i = 0; i < len; i++)
+    {
+        parseCommands((const uint8_t *)in + i, 1);
+        checkState();
+    }
+}
+
+//i, q and y start binary uploads, l the benchmark and p prints the profile
+static const char anyCommand[] = "#fbcmxersStuw;0123456789abcdefABCDEF zZ\x1b[;?HJKmsu78\r\n\x7f";
+static const char screenOnly[] = "#fbcx;0123456789abcdefABCDEF zZ\x1b[;HJKmsu78";
+
+static void testRandom(void)
+{
+    char in[MAXFUZZLEN + 1];
+    int run, len;
+
+    srand(1);
+    resetTerminal();
+    for (run = 0; run < FUZZRUNS && !failures; run++)
+    {
+        len = randomSequence(in, anyCommand);
+        strcpy(lastInput, in);
+        feed(in, len, rand() & 1);
+        feed("\n", 1, false);
+        if (!failures && terms[CONSOLE].presentState != idle)
+        {
+            printf("FAIL: state %d, not back to text after \"%s\" and a newline\n", terms[CONSOLE].presentState, in);
+            failures++;
+        }
+        LCDRenderFrame();
+    }
+    printf("random sequences: %d runs\n", run);
+}
+
+typedef struct {
+    char chars[MAXROWS][MAXCOLS];
+    uint8_t attrs[MAXROWS][MAXCOLS];
+    int rowNum, colNum;
+    color_t fg, bg;
+    uint8_t tx[256];
+    int txLen;
+} snapshot_t;
+
+static void snapshot(snapshot_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    memcpy(s->chars, screenChars, sizeof(screenChars));
+    memcpy(s->attrs, screenAttrs, sizeof(screenAttrs));
+    s->rowNum = terms[CONSOLE].rowNum;
+    s->colNum = terms[CONSOLE].colNum;
+    s->fg = terms[CONSOLE].fg;
+    s->bg = terms[CONSOLE].bg;
+    s->txLen = stubTxLen < (int)sizeof(s->tx) ? stubTxLen : (int)sizeof(s->tx);
+    memcpy(s->tx, stubTx, s->txLen);
+}
+
+static void testBatchMatchesBytes(void)
+{
+    char in[MAXFUZZLEN + 1];
+    snapshot_t batch, bytes;
+    int run, len;
+
+    srand(2);
+    for (run = 0; run < FUZZRUNS && !failures; run++)
+    {
+        len = randomSequence(in, screenOnly);
+        strcpy(lastInput, in);
+
+        resetTerminal();
+        feed(in, len, false);
+        feed("\n", 1, false);
+        snapshot(&batch);
+
+        resetTerminal();
+        feed(in, len, true);
+        feed("\n", 1, true);
+        snapshot(&bytes);
+
+        if (!failures && memcmp(&batch, &bytes, sizeof(batch)) != 0)
+        {
+            printf("FAIL: \"%s\" leaves a different screen in one batch than a byte at a time\n", in);
+            failures++;
+        }
+    }
+    printf("batch against byte at a time: %d runs\n", run);
+}
+
+static void testOpcodeIndex(void)//every opcode is found from its first character, and nothing else is
+{
+    int c, i;
+
+    for (c = 0; c < OPCODECHARS; c++)
+    {
+        int first = -1, last = -1;
+        for (i = 0; i < NUMCOMMANDS; i++)
+        {
+            if (commandTable[i].opcode[0] == c)
+            {
+                if (first < 0)
+                    first = i;
+                last = i;
+            }
+        }
+        if (first < 0 ? commandFirst[c] <= commandLast[c] : commandFirst[c] != first || commandLast[c] != last)
+        {
+            printf("FAIL: index of '%c' is %d..%d, the table has %d..%d\n", c, commandFirst[c], commandLast[c], first, last);
+            failures++;
+        }
+    }
+    for (i = 1; i < NUMCOMMANDS; i++)
+    {
+        if (strcmp(commandTable[i - 1].opcode, commandTable[i].opcode) >= 0)
+        {
+            printf("FAIL: commandTable is not sorted at \"%s\"\n", commandTable[i].opcode);
+            failures++;
+        }
+    }
+}
+
+int main(void)
+{
+    InitCycleCounter();
+    InitTerms();
+    InitCommands();
+    InitCRC32();
+
+    testOpcodeIndex();
+    testRandom();
+    testBatchMatchesBytes();
+
+    printf(failures ? "parser: FAILED\n" : "parser: ok\n");
+    return failures != 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * #q QOI uploads: sample images are encoded here the way tools/qoi_encode.py
+ * and any other QOI encoder does it, sent through parseCommands and read
+ * back off the stubPanel pixel for pixel.
+ *
+ * Each image goes in as one batch, then with every chunk in a batch of its
+ * own, then a byte at a time, so the decoder has to carry a chunk, the
+ * header and the end marker across the breaks the RX ring makes. Then it
+ * goes through sim.c at each baud rate, and the compression ratio and the
+ * frame time from the first byte sent to the last pixel drawn are printed
+ * next to what the same image takes as raw RGB565 with #i.
+ */
+#include "sim.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PANELCYCLES 3 //per byte on SPI, about what the panel takes at MCLK
+#define IMAGEX 0
+#define IMAGEY 16 //below the status rows, which keep drawing
+#define IMAGEW 128
+#define IMAGEH 112
+#define QOIMAX (4 + 14 + IMAGEW * IMAGEH * 5 + 8)
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; return; } } while (0)
+
+typedef struct { uint8_t r, g, b, a; } rgba_t;
+
+static rgba_t image[IMAGEH][IMAGEW];
+static uint8_t upload[QOIMAX];
+static int uploadLen;
+static int chunkAt[IMAGEW * IMAGEH + 2];//where each chunk starts in upload, the end marker last
+static int chunks;
+
+//------------------------------------------
+// Encoder
+
+static int qoiHash(rgba_t p)
+{
+    return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+}
+
+static bool samePixel(rgba_t p, rgba_t q)
+{
+    return p.r == q.r && p.g == q.g && p.b == q.b && p.a == q.a;
+}
+
+static void put32(uint32_t v)
+{
+    upload[uploadLen++] = v >> 24;
+    upload[uploadLen++] = v >> 16;
+    upload[uploadLen++] = v >> 8;
+    upload[uploadLen++] = v;
+}
+
+static void startChunk(void)
+{
+    chunkAt[chunks++] = uploadLen;
+}
+
+static void encode(void)//"#q", x, y and the .qoi file of image
+{
+    rgba_t index[64], prev = {0, 0, 0, 255}, p;
+    int i, run = 0, total = IMAGEW * IMAGEH;
+
+    memset(index, 0, sizeof(index));
+    uploadLen = chunks = 0;
+    upload[uploadLen++] = '#';
+    upload[uploadLen++] = 'q';
+    upload[uploadLen++] = IMAGEX;
+    upload[uploadLen++] = IMAGEY;
+    memcpy(upload + uploadLen, "qoif", 4);
+    uploadLen += 4;
+    put32(IMAGEW);
+    put32(IMAGEH);
+    upload[uploadLen++] = 4;
+    upload[uploadLen++] = 0;
+
+    for (i = 0; i < total; i++)
+    {
+        p = image[i / IMAGEW][i % IMAGEW];
+        if (samePixel(p, prev))
+        {
+            if (++run == 62 || i == total - 1)
+            {
+                startChunk();
+                upload[uploadLen++] = 0xC0 | (run - 1);
+                run = 0;
+            }
+            continue;
+        }
+        if (run)
+        {
+            startChunk();
+            upload[uploadLen++] = 0xC0 | (run - 1);
+            run = 0;
+        }
+        startChunk();
+        if (samePixel(index[qoiHash(p)], p))
+        {
+            upload[uploadLen++] = qoiHash(p);
+        }
+        else
+        {
+            int8_t vr = p.r - prev.r, vg = p.g - prev.g, vb = p.b - prev.b;
+            int8_t vgr = vr - vg, vgb = vb - vg;
+
+            index[qoiHash(p)] = p;
+            if (p.a != prev.a)
+            {
+                upload[uploadLen++] = 0xFF;
+                upload[uploadLen++] = p.r;
+                upload[uploadLen++] = p.g;
+                upload[uploadLen++] = p.b;
+                upload[uploadLen++] = p.a;
+            }
+            else if (vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1)
+            {
+                upload[uploadLen++] = 0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+            }
+            else if (vg >= -32 && vg <= 31 && vgr >= -8 && vgr <= 7 && vgb >= -8 && vgb <= 7)
+            {
+                upload[uploadLen++] = 0x80 | (vg + 32);
+                upload[uploadLen++] = (vgr + 8) << 4 | (vgb + 8);
+            }
+            else
+            {
+                upload[uploadLen++] = 0xFE;
+                upload[uploadLen++] = p.r;
+                upload[uploadLen++] = p.g;
+                upload[uploadLen++] = p.b;
+            }
+        }
+        prev = p;
+    }
+    chunkAt[chunks] = uploadLen;//the end marker
+    memset(upload + uploadLen, 0, 7);
+    upload[uploadLen + 7] = 1;
+    uploadLen += 8;
+}
+
+//------------------------------------------
+// Sample images
+
+static void makeStatus(void)//flat panels with bars and blocky text, mostly runs and index hits
+{
+    int x, y;
+
+    for (y = 0; y < IMAGEH; y++)
+    {
+        for (x = 0; x < IMAGEW; x++)
+        {
+            rgba_t p = {16, 24, 64, 255};
+
+            if (y % 28 < 4)
+                p = (rgba_t){200, 200, 200, 255};
+            else if (y % 28 > 8 && y % 28 < 20 && x > 8 && x < 8 + (y / 28 + 1) * 28)
+                p = (y / 28) % 2 ? (rgba_t){40, 200, 40, 255} : (rgba_t){220, 60, 30, 255};
+            else if (y % 28 >= 22 && ((x / 2 + y) * 7) % 5 == 0)
+                p = (rgba_t){255, 255, 255, 255};
+            image[y][x] = p;
+        }
+    }
+}
+
+static void makeGradient(void)//smooth shades, mostly DIFF and LUMA
+{
+    int x, y;
+
+    for (y = 0; y < IMAGEH; y++)
+        for (x = 0; x < IMAGEW; x++)
+            image[y][x] = (rgba_t){x, 64 + y, 128 + (x + y) / 4, 255};
+}
+
+static void makePhoto(void)//a gradient with grain on it, the middle ground
+{
+    int x, y;
+
+    srand(1);
+    for (y = 0; y < IMAGEH; y++)
+        for (x = 0; x < IMAGEW; x++)
+            image[y][x] = (rgba_t){x + rand() % 3, 60 + y / 2 + rand() % 3, 200 - x / 2 + rand() % 3, 255};
+}
+
+static void makeNoise(void)//nothing to compress, RGB and RGBA with alpha that isn't drawn
+{
+    int x, y;
+
+    srand(2);
+    for (y = 0; y < IMAGEH; y++)
+        for (x = 0; x < IMAGEW; x++)
+            image[y][x] = (rgba_t){rand(), rand(), rand(), rand() % 4 ? 255 : rand()};
+}
+
+static const struct {
+    const char *name;
+    void (*make)(void);
+} samples[] = {
+    {"status", makeStatus},
+    {"gradient", makeGradient},
+    {"photo", makePhoto},
+    {"noise", makeNoise},
+};
+#define NUMSAMPLES (int)(sizeof(samples) / sizeof(samples[0]))
+
+//------------------------------------------
+// Tests
+
+static uint16_t rgb565(rgba_t p)
+{
+    return (p.r >> 3) << 11 | (p.g >> 2) << 5 | p.b >> 3;
+}
+
+static bool panelHolds(const char *name, const char *how)
+{
+    int x, y;
+
+    for (y = 0; y < IMAGEH; y++)
+    {
+        for (x = 0; x < IMAGEW; x++)
+        {
+            if (stubPanel[IMAGEY + y][IMAGEX + x] != rgb565(image[y][x]))
+            {
+                printf("FAIL %s %s: pixel %d,%d is %04x, not %04x\n", name, how, x, y,
+                       stubPanel[IMAGEY + y][IMAGEX + x], rgb565(image[y][x]));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void boot(int rate, uint32_t blitCycles)
+{
+    simInit(rate, blitCycles);
+    memset(stubPanel, 0, sizeof(stubPanel));//so the last run's image can't pass for this one
+}
+
+static void testSplits(const char *name)
+{
+    int i;
+
+    boot(baud57600, 0);
+    parseCommands(upload, uploadLen);
+    CHECK(term->presentState == idle, "%s: still in the upload after one batch", name);
+    CHECK(panelHolds(name, "in one batch"), "%s", name);
+
+    boot(baud57600, 0);
+    parseCommands(upload, chunkAt[0]);//"#q", x, y and the header
+    for (i = 0; i < chunks; i++)
+        parseCommands(upload + chunkAt[i], chunkAt[i + 1] - chunkAt[i]);
+    CHECK(term->presentState != idle, "%s: left the upload before the end marker", name);
+    parseCommands(upload + chunkAt[chunks], uploadLen - chunkAt[chunks]);
+    CHECK(term->presentState == idle, "%s: still in the upload after a batch per chunk", name);
+    CHECK(panelHolds(name, "a batch per chunk"), "%s", name);
+
+    boot(baud57600, 0);
+    for (i = 0; i < uploadLen; i++)
+        parseCommands(upload + i, 1);
+    CHECK(term->presentState == idle, "%s: still in the upload a byte at a time", name);
+    CHECK(panelHolds(name, "a byte at a time"), "%s", name);
+}
+
+static void frameTime(const char *name)
+{
+    int rate;
+    uint32_t raw = IMAGEW * IMAGEH * 2, start, overflows;
+
+    printf("%-8s %5d bytes, %5.1f%% of raw RGB565, frame time:", name, uploadLen, 100.0 * uploadLen / raw);
+    for (rate = baud9600; rate <= baud57600; rate++)
+    {
+        boot(rate, PANELCYCLES);
+        simRun(100000);//the boot screen goes out first
+        overflows = rxOverflows;
+        start = CycleCount();
+        simSend(upload, uploadLen);
+        while (simPending() || term->presentState != idle)
+            simRun(1000);
+        printf(" %s %5u ms (raw %5u)", baudNames[rate], (unsigned)((CycleCount() - start) / CYCLES_PER_MS),
+               (unsigned)((uint64_t)(raw + 6) * 10 * 1000 / baudValues[rate]));
+        CHECK(rxOverflows == overflows, "\n%s: %u bytes dropped at %s baud", name, (unsigned)(rxOverflows - overflows), baudNames[rate]);
+        CHECK(panelHolds(name, baudNames[rate]), "%s", name);
+    }
+    printf("\n");
+}
+
+int main(void)
+{
+    int i;
+
+    for (i = 0; i < NUMSAMPLES; i++)
+    {
+        samples[i].make();
+        encode();
+        testSplits(samples[i].name);
+        frameTime(samples[i].name);
+    }
+
+    printf(failures ? "qoi: FAILED\n" : "qoi: ok\n");
+    return failures != 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * The scheduler on the simulated clock of sim.c: text streams in at 57600
+ * baud while the panel takes PANELCYCLES per byte, so a frame of text
+ * costs several times RENDERSLICE to draw. The render task has to stop at
+ * its slice, after the row it is on, and go on from the next row in its
+ * next run. No byte then waits in the RX ring past the rx task's deadline,
+ * none is dropped, and once the text stops the panel shows what screenChars holds.
+ */
+#include "sim.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PANELCYCLES 3 //per byte on SPI, about what the panel takes at MCLK
+#define ROWCYCLES (MAXCOLS * 6 * 8 * 2 * PANELCYCLES + CYCLES_PER_MS) //one row of glyphs and the work around it
+#define STREAMBYTES 11520 //two seconds at 57600
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; return; } } while (0)
+
+static uint16_t cellPixel(int color, bool isFg)
+{
+    const term_t *t = &terms[CONSOLE];
+
+    if (color == custom)
+        return SWAP16(isFg ? t->customFgPixel : t->customBgPixel);
+    return SWAP16(colorTable[color]);
+}
+
+static bool panelMatches(void)
+{
+    const term_t *t = &terms[CONSOLE];
+    int row, col;
+
+    for (row = t->top; row < t->top + t->rows; row++)
+    {
+        for (col = 0; col < termCols; col++)
+        {
+            char c;
+            uint16_t fgPixel, bgPixel;
+            uint8_t attr = screenAttrs[row][col];
+            bool drawn = stubPanelCell(row, col, &c, &fgPixel, &bgPixel);
+            bool filled = !drawn && fgPixel == bgPixel;//erased cells are filled, not drawn as a space
+
+            if (filled ? screenChars[row][col] != ' ' || bgPixel != cellPixel(attr >> 4, false) :
+                c != screenChars[row][col] || fgPixel != cellPixel(attr & 0xF, true) || bgPixel != cellPixel(attr >> 4, false))
+            {
+                printf("FAIL: panel row %d col %d shows '%c', the screen has '%c'\n", row, col, c, screenChars[row][col]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void resetStats(void)
+{
+    int i;
+
+    for (i = 0; i < NUMTASKS; i++)
+        tasks[i].runs = tasks[i].late = tasks[i].maxWait = tasks[i].maxRun = 0;
+}
+
+static void testRenderYields(void)
+{
+    static uint8_t stream[STREAMBYTES];
+    uint32_t overflows, yielded = 0;
+    int i;
+
+    srand(1);
+    for (i = 0; i < STREAMBYTES; i++)//text all over the screen, a new line now and then, no commands
+    {
+        stream[i] = rand() % 24 == 0 ? '\n' : ' ' + 1 + rand() % 94;
+        if (stream[i] == '#')
+            stream[i] = '=';
+    }
+
+    simInit(baud57600, PANELCYCLES);
+    overflows = rxOverflows;
+    resetStats();
+    simSend(stream, STREAMBYTES);
+    while (simPending())
+    {
+        simRun(500);
+        if (renderRow > 0)
+            yielded++;
+    }
+    simRun(100000);//the text has stopped, the last frame goes out
+
+    for (i = 0; i < NUMTASKS; i++)
+        printf("%-6s %5u runs, wait max %5u us, run max %5u us, late %u\n", tasks[i].name, (unsigned)tasks[i].runs,
+               (unsigned)(tasks[i].maxWait / (CYCLES_PER_MS / 1000)), (unsigned)(tasks[i].maxRun / (CYCLES_PER_MS / 1000)),
+               (unsigned)tasks[i].late);
+    printf("longest a byte waited in the RX ring: %u us\n", (unsigned)(simMaxRxAge / (CYCLES_PER_MS / 1000)));
+    printf("frames: %u, %u glyphs max, %u times a frame was left for the next run\n",
+           (unsigned)frameCount, (unsigned)frameMaxGlyphs, (unsigned)yielded);
+
+    CHECK(frameMaxGlyphs * 6 * 8 * 2 * PANELCYCLES > 2 * RENDERSLICE, "no frame took more than a slice, the test is too easy");
+    CHECK(yielded > 0, "the render task never left a frame for its next run");
+    CHECK(tasks[1].maxRun <= RENDERSLICE + ROWCYCLES, "a render run took %u cycles, the slice is %u",
+          (unsigned)tasks[1].maxRun, RENDERSLICE);
+    CHECK(simMaxRxAge <= tasks[0].deadline, "a byte waited %u cycles in the RX ring, the rx deadline is %u",
+          (unsigned)simMaxRxAge, (unsigned)tasks[0].deadline);
+    for (i = 0; i < NUMTASKS; i++)
+        CHECK(tasks[i].late == 0, "task %s started past its deadline %u times", tasks[i].name, (unsigned)tasks[i].late);
+    CHECK(rxOverflows == overflows, "%u bytes dropped", (unsigned)(rxOverflows - overflows));
+    CHECK(renderRow == 0 && !screenDirty, "text still waiting to be drawn after the stream stopped");
+    CHECK(panelMatches(), "the panel doesn't show the screen");
+}
+
+int main(void)
+{
+    testRenderYields();
+
+    printf(failures ? "scheduler: FAILED\n" : "scheduler: ok\n");
+    return failures != 0;
+}
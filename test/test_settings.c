@@ -0,0 +1,211 @@
+/*
+ * The settings store in the stubInfo model of INFO flash, with the power
+ * cut at every byte of a save.
+ *
+ * A change of a setting is saved once things are quiet for SETTINGSQUIET.
+ * A change of the character counter on its own waits for SETTINGSMAXDELAY,
+ * however long the quiet. Saves go round both store sectors, each one
+ * erased only when the store comes back to it, and a reboot after any of
+ * them gets the last one back. The TLV and BSL sectors hold a pattern
+ * that has to survive all of it.
+ *
+ * A save cut short, in the program or in the erase that starts a sector,
+ * brings back the record before it at the next boot, and the store goes on
+ * from there: the next save is the one a reboot then gets.
+ */
+#define main firmwareMain
+#include "../main.c"
+#undef main
+
+#include <stdio.h>
+#include "hal_stub.h"
+
+#define TLVSECTOR 1
+#define BSLSECTOR 2
+
+static int failures = 0;
+static UARTBaudRate_t bootBaud;
+static term_t bootConsole;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; return; } } while (0)
+
+static uint8_t factory(int at)//what the TLV and the BSL hold
+{
+    return (uint8_t)(at * 7 + 3);
+}
+
+static void blankInfo(void)
+{
+    int i;
+
+    memset(stubInfo, 0xFF, STUBINFOSIZE);
+    for (i = TLVSECTOR * STUBINFOSECTOR; i < (BSLSECTOR + 1) * STUBINFOSECTOR; i++)
+        stubInfo[i] = factory(i);
+    memset(stubInfoErases, 0, sizeof(stubInfoErases));
+    memset(stubInfoPrograms, 0, sizeof(stubInfoPrograms));
+}
+
+static bool factoryIntact(void)
+{
+    int i;
+
+    for (i = TLVSECTOR * STUBINFOSECTOR; i < (BSLSECTOR + 1) * STUBINFOSECTOR; i++)
+        if (stubInfo[i] != factory(i))
+            return false;
+    return !stubInfoErases[TLVSECTOR] && !stubInfoErases[BSLSECTOR] &&
+           !stubInfoPrograms[TLVSECTOR] && !stubInfoPrograms[BSLSECTOR];
+}
+
+static void reboot(void)//RAM back to what main() starts with, then the settings from flash
+{
+    baudRate = bootBaud;
+    terms[CONSOLE] = bootConsole;
+    charCounter = 0;
+    settingsSeq = settingsSaves = 0;
+    stubFlashBudget = -1;
+    SettingsLoad();
+}
+
+static void wait(uint32_t ms)//the store task polls every second or so
+{
+    uint32_t i;
+
+    for (i = 0; i < ms; i += 500)
+    {
+        dwt.CYCCNT += 500 * CYCLES_PER_MS;
+        SettingsPoll();
+    }
+}
+
+static void save(uint16_t value)//one record, value in customFgPixel
+{
+    terms[CONSOLE].customFgPixel = value;
+    SettingsPoll();
+    wait(SETTINGSQUIET / CYCLES_PER_MS + 500);
+}
+
+static void testFresh(void)
+{
+    blankInfo();
+    reboot();
+    CHECK(settingsNext == SETTINGS_SLOTS, "blank INFO, the first save doesn't erase");
+    CHECK(terms[CONSOLE].fg == bootConsole.fg && baudRate == bootBaud, "blank INFO changed the defaults");
+}
+
+static void testQuiet(void)
+{
+    blankInfo();
+    reboot();
+    terms[CONSOLE].fg = red;
+    baudRate = baud38400;
+    SettingsPoll();
+    wait(SETTINGSQUIET / CYCLES_PER_MS - 500);
+    CHECK(settingsSaves == 0, "saved before things were quiet");
+    wait(1000);
+    CHECK(settingsSaves == 1, "%u saves once quiet", (unsigned)settingsSaves);
+    reboot();
+    CHECK(terms[CONSOLE].fg == red && baudRate == baud38400, "not restored");
+}
+
+static void testCounter(void)
+{
+    uint32_t ms;
+
+    blankInfo();
+    reboot();
+    charCounter = 1234;
+    SettingsPoll();
+    wait(SETTINGSMAXDELAY / CYCLES_PER_MS - 1000);
+    CHECK(settingsSaves == 0, "the counter on its own saved before SETTINGSMAXDELAY");
+    wait(1000);
+    CHECK(settingsSaves == 1, "the counter on its own never saved");
+    reboot();
+    CHECK(charCounter == 1234, "counter %u after reboot", (unsigned)charCounter);
+
+    for (ms = 0; ms < 10 * SETTINGSMAXDELAY / CYCLES_PER_MS; ms += 500)//steady traffic
+    {
+        charCounter += 40;
+        wait(500);
+    }
+    CHECK(settingsSaves >= 9 && settingsSaves <= 10, "%u saves in ten SETTINGSMAXDELAY of traffic", (unsigned)settingsSaves);
+
+    terms[CONSOLE].fg = green;//a setting goes out once quiet, the counter with it
+    wait(SETTINGSQUIET / CYCLES_PER_MS + 500);
+    ms = charCounter;
+    reboot();
+    CHECK(terms[CONSOLE].fg == green && charCounter == ms, "the quiet save didn't carry the counter");
+
+    terms[CONSOLE].fg = blue;//changed and changed back, the counter still waits
+    SettingsPoll();
+    terms[CONSOLE].fg = green;
+    charCounter++;
+    ms = settingsSaves;
+    wait(SETTINGSQUIET / CYCLES_PER_MS + 500);
+    CHECK(settingsSaves == ms, "the counter was saved on the quiet path");
+}
+
+static void testWrap(void)
+{
+    int i, saves = 3 * SETTINGS_SLOTS + 5;
+
+    blankInfo();
+    reboot();
+    for (i = 1; i <= saves; i++)
+    {
+        save(i);
+        reboot();
+        CHECK(terms[CONSOLE].customFgPixel == i, "save %d: %u came back", i, terms[CONSOLE].customFgPixel);
+    }
+    CHECK(stubInfoErases[3] == 2 && stubInfoErases[0] == 2, "erases %u and %u for %d saves",
+          (unsigned)stubInfoErases[3], (unsigned)stubInfoErases[0], saves);
+    CHECK(factoryIntact(), "the TLV or the BSL was written");
+}
+
+//the power goes cut bytes into the save after the first before ones
+static void cutSave(int before, int cut)
+{
+    int i, need = sizeof(settings_t) + (before % SETTINGS_SLOTS == 0 ? STUBINFOSECTOR : 0);//and the erase
+
+    blankInfo();
+    reboot();
+    for (i = 1; i <= before; i++)
+        save(i);
+    reboot();
+
+    stubFlashBudget = cut;
+    save(before + 1);
+    reboot();
+    CHECK(terms[CONSOLE].customFgPixel == (cut >= need ? before + 1 : before),
+          "%d saves, cut at %d: %u came back", before, cut, terms[CONSOLE].customFgPixel);
+    save(before + 2);
+    reboot();
+    CHECK(terms[CONSOLE].customFgPixel == before + 2, "%d saves, cut at %d: the next save didn't stick", before, cut);
+    CHECK(factoryIntact(), "the TLV or the BSL was written");
+}
+
+static void testPowerLoss(void)
+{
+    int cut, erase = STUBINFOSECTOR;
+
+    for (cut = 0; cut <= (int)sizeof(settings_t); cut++)
+        cutSave(5, cut);//in the middle of a sector
+    for (cut = 0; cut <= erase + (int)sizeof(settings_t); cut += cut < 40 || cut >= erase - 4 ? 1 : 97)
+        cutSave(2 * SETTINGS_SLOTS, cut);//both full, the first sector is erased over its old records
+    for (cut = 0; cut < (int)sizeof(settings_t); cut++)//the record right after an erase
+        cutSave(SETTINGS_SLOTS, erase + cut);
+}
+
+int main(void)
+{
+    bootBaud = baudRate;
+    bootConsole = terms[CONSOLE];
+
+    testFresh();
+    testQuiet();
+    testCounter();
+    testWrap();
+    testPowerLoss();
+
+    printf(failures ? "settings: FAILED\n" : "settings: ok\n");
+    return failures != 0;
+}
@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+"""Reference sender for the framed mode of the terminal (#y1).
+
+Sends a file, or stdin, to the board as FRAMETEXT frames and keeps to the
+flow control described in main.c under "Framed mode":
+
+  * every frame is SLIP framed: seq, opcode, payload, CRC-32 (little endian)
+  * the board answers each frame with ACK or NAK, the seq and its credit,
+    the free space in its RX ring when the reply went out
+  * after a reply for frame s with credit C, the bytes sent after frame s,
+    SLIP escapes included, are kept at or below C
+  * frames are run in seq order, so a NAK, or no reply within the timeout,
+    sends everything again from the oldest frame not ACKed (go-back-N)
+
+    framed_send.py /dev/ttyACM0 --baud 57600 file.txt
+    cat log | framed_send.py /dev/ttyACM0
+
+Needs pyserial for a real port. Sender only needs a link object with
+write(bytes) and read(timeout) -> bytes, which is how test/test_framed.py
+runs it against the simulated firmware.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+SLIP_END = 0xC0
+SLIP_ESC = 0xDB
+SLIP_ESC_END = 0xDC
+SLIP_ESC_ESC = 0xDD
+
+FRAMEACK = 0x06
+FRAMENAK = 0x15
+FRAMEEXIT = 0x00
+FRAMETEXT = 0x01
+
+MAXPAYLOAD = 256
+MAXOUTSTANDING = 127  # frames sent and not ACKed, keeps the 8 bit seq unambiguous
+
+
+def slip_encode(frame):
+    out = bytearray([SLIP_END])
+    for b in frame:
+        if b == SLIP_END:
+            out += bytes([SLIP_ESC, SLIP_ESC_END])
+        elif b == SLIP_ESC:
+            out += bytes([SLIP_ESC, SLIP_ESC_ESC])
+        else:
+            out.append(b)
+    out.append(SLIP_END)
+    return bytes(out)
+
+
+class SlipDecoder:
+    """Collects SLIP frames out of a byte stream."""
+
+    def __init__(self):
+        self.frame = bytearray()
+        self.escaped = False
+
+    def feed(self, data):
+        frames = []
+        for b in data:
+            if b == SLIP_END:
+                if self.frame:
+                    frames.append(bytes(self.frame))
+                self.frame = bytearray()
+                self.escaped = False
+            elif self.escaped:
+                self.escaped = False
+                self.frame.append(SLIP_END if b == SLIP_ESC_END else SLIP_ESC if b == SLIP_ESC_ESC else b)
+            elif b == SLIP_ESC:
+                self.escaped = True
+            else:
+                self.frame.append(b)
+        return frames
+
+
+def make_frame(seq, opcode, payload):
+    body = bytes([seq & 0xFF, opcode]) + bytes(payload)
+    return body + struct.pack('<I', zlib.crc32(body))
+
+
+def parse_reply(frame):
+    """(type, seq, credit) of a reply from the board, None if it is damaged."""
+    if len(frame) != 8 or struct.unpack('<I', frame[4:])[0] != zlib.crc32(frame[:4]):
+        return None
+    if frame[0] not in (FRAMEACK, FRAMENAK):
+        return None
+    return frame[0], frame[1], frame[2] | frame[3] << 8
+
+
+class Sender:
+    """Go-back-N within the board's credit."""
+
+    def __init__(self, link, timeout=0.5, poll=0.01, log=None, max_timeouts=20):
+        self.link = link
+        self.timeout = timeout
+        self.max_timeouts = max_timeouts  # in a row, then the board is taken to be gone
+        self.poll = poll
+        self.log = log
+        self.decoder = SlipDecoder()
+        self.frames_sent = 0
+        self.retransmits = 0
+        self.naks = 0
+        self.timeouts = 0
+        self.bad_replies = 0
+
+    def start(self):
+        self.link.write(b'#y1')
+
+    def send(self, frames, seq0=0):
+        """frames is a list of (opcode, payload), all are ACKed when it returns."""
+        encoded = [slip_encode(make_frame(seq0 + i, op, payload)) for i, (op, payload) in enumerate(frames)]
+        base = 0  # oldest frame not ACKed
+        nxt = 0  # next frame to send
+        sent = {}  # frame index -> (start, end) byte offsets of its last transmission
+        total = 0  # bytes written so far
+        limit = 0  # total may not go past this, from the last credit
+        rewound_at = 0  # NAKs for transmissions that started before this are already dealt with
+        idle = 0.0
+        silent = 0  # timeouts since the last reply
+
+        while base < len(encoded):
+            while nxt < len(encoded) and nxt - base < MAXOUTSTANDING:
+                frame = encoded[nxt]
+                if total + len(frame) > limit and nxt > base:
+                    break  # nothing may go out before the credit covers it, except one frame when all are answered
+                self.link.write(frame)
+                if nxt in sent:
+                    self.retransmits += 1
+                sent[nxt] = (total, total + len(frame))
+                total += len(frame)
+                self.frames_sent += 1
+                nxt += 1
+
+            data = self.link.read(self.poll)
+            if not data:
+                idle += self.poll
+                if idle >= self.timeout and nxt > base:
+                    self.timeouts += 1
+                    silent += 1
+                    if silent >= self.max_timeouts:
+                        raise IOError('no reply from the board for %d tries' % silent)
+                    nxt = base
+                    rewound_at = total
+                    limit = total
+                    idle = 0.0
+                continue
+            idle = 0.0
+
+            for frame in self.decoder.feed(data):
+                reply = parse_reply(frame)
+                if reply is None:
+                    self.bad_replies += 1
+                    continue
+                kind, seq, credit = reply
+                silent = 0
+                index = self._find(seq, seq0, base, nxt)
+                if index is None:
+                    continue  # for a frame that's already ACKed
+                start, end = sent[index]
+                limit = max(limit, end + credit)
+                if kind == FRAMEACK:
+                    base = index + 1
+                    if nxt < base:
+                        nxt = base
+                elif start >= rewound_at:
+                    self.naks += 1
+                    if self.log:
+                        self.log('NAK seq %d, back to seq %d' % (seq, (seq0 + base) & 0xFF))
+                    nxt = base
+                    rewound_at = total
+
+        return seq0 + len(encoded)
+
+    @staticmethod
+    def _find(seq, seq0, base, nxt):
+        """Index of the frame not yet ACKed with this seq, the board runs them in order."""
+        for index in range(base, nxt):
+            if (seq0 + index) & 0xFF == seq:
+                return index
+        return None
+
+    def finish(self, seq):
+        self.send([(FRAMEEXIT, b'')], seq0=seq)
+
+
+def text_frames(data):
+    return [(FRAMETEXT, data[i:i + MAXPAYLOAD]) for i in range(0, len(data), MAXPAYLOAD)]
+
+
+class SerialLink:
+    def __init__(self, port, baud):
+        import serial  # pyserial, only needed for a real port
+        self.port = serial.Serial(port, baud, timeout=0)
+
+    def write(self, data):
+        self.port.write(data)
+
+    def read(self, timeout):
+        self.port.timeout = timeout
+        data = self.port.read(1)
+        self.port.timeout = 0
+        return data + self.port.read(4096) if data else b''
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('port')
+    parser.add_argument('file', nargs='?', help='text to send, stdin if left out')
+    parser.add_argument('--baud', type=int, default=9600)
+    parser.add_argument('--timeout', type=float, default=0.5, help='seconds without a reply before sending again')
+    args = parser.parse_args()
+
+    data = open(args.file, 'rb').read() if args.file else sys.stdin.buffer.read()
+    sender = Sender(SerialLink(args.port, args.baud), timeout=args.timeout,
+                    log=lambda s: print(s, file=sys.stderr))
+    sender.start()
+    seq = sender.send(text_frames(data))
+    sender.finish(seq)
+    print('%d bytes in %d frames, %d sent again, %d NAKs, %d timeouts' %
+          (len(data), seq, sender.retransmits, sender.naks, sender.timeouts), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
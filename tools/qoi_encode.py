@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""QOI encoder for the #q image upload of the terminal.
+
+Encodes a binary PPM (P6) or PAM (P7, RGB or RGB_ALPHA) image as QOI, the
+format main.c decodes as it streams in under "QOI image upload", and either
+writes the .qoi file or sends it to the board behind "#q x y":
+
+    qoi_encode.py status.ppm status.qoi
+    qoi_encode.py status.ppm --port /dev/ttyACM0 --baud 57600 --at 0 16
+
+Each run prints the size against raw RGB565 (#i) and how long both take on
+the line at the chosen baud rate. Needs pyserial only with --port.
+"""
+
+import argparse
+import struct
+import sys
+
+QOI_OP_INDEX = 0x00
+QOI_OP_DIFF = 0x40
+QOI_OP_LUMA = 0x80
+QOI_OP_RUN = 0xC0
+QOI_OP_RGB = 0xFE
+QOI_OP_RGBA = 0xFF
+QOI_END = bytes(7) + b'\x01'
+MAXRUN = 62
+PANEL = 128
+
+
+def qoi_hash(px):
+    r, g, b, a = px
+    return (r * 3 + g * 5 + b * 7 + a * 11) % 64
+
+
+def encode(width, height, pixels, channels=4):
+    """pixels is a list of (r, g, b, a), row by row."""
+    out = bytearray(b'qoif' + struct.pack('>II', width, height) + bytes([channels, 0]))
+    index = [(0, 0, 0, 0)] * 64
+    prev = (0, 0, 0, 255)
+    run = 0
+
+    for i, px in enumerate(pixels):
+        if px == prev:
+            run += 1
+            if run == MAXRUN or i == len(pixels) - 1:
+                out.append(QOI_OP_RUN | (run - 1))
+                run = 0
+            continue
+        if run:
+            out.append(QOI_OP_RUN | (run - 1))
+            run = 0
+        h = qoi_hash(px)
+        if index[h] == px:
+            out.append(QOI_OP_INDEX | h)
+        else:
+            index[h] = px
+            if px[3] != prev[3]:
+                out += bytes([QOI_OP_RGBA]) + bytes(px)
+            else:
+                vr = (px[0] - prev[0] + 128) % 256 - 128
+                vg = (px[1] - prev[1] + 128) % 256 - 128
+                vb = (px[2] - prev[2] + 128) % 256 - 128
+                vg_r, vg_b = vr - vg, vb - vg
+                if -2 <= vr <= 1 and -2 <= vg <= 1 and -2 <= vb <= 1:
+                    out.append(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2))
+                elif -32 <= vg <= 31 and -8 <= vg_r <= 7 and -8 <= vg_b <= 7:
+                    out += bytes([QOI_OP_LUMA | (vg + 32), (vg_r + 8) << 4 | (vg_b + 8)])
+                else:
+                    out += bytes([QOI_OP_RGB]) + bytes(px[:3])
+        prev = px
+    return bytes(out + QOI_END)
+
+
+def read_netpbm(data):
+    """(width, height, channels, pixels) of a binary PPM or PAM."""
+    fields = {}
+    if data.startswith(b'P7'):
+        header, _, body = data.partition(b'ENDHDR\n')
+        for line in header.split(b'\n')[1:]:
+            parts = line.split()
+            if parts and not parts[0].startswith(b'#'):
+                fields[parts[0].decode()] = parts[1].decode()
+        width, height, depth = int(fields['WIDTH']), int(fields['HEIGHT']), int(fields['DEPTH'])
+        if int(fields.get('MAXVAL', 255)) != 255 or depth not in (3, 4):
+            raise ValueError('only 8 bit RGB or RGB_ALPHA PAM')
+    elif data.startswith(b'P6'):
+        tokens = []
+        pos = 2
+        while len(tokens) < 3:
+            while data[pos:pos + 1].isspace():
+                pos += 1
+            if data[pos:pos + 1] == b'#':
+                pos = data.index(b'\n', pos)
+                continue
+            start = pos
+            while not data[pos:pos + 1].isspace():
+                pos += 1
+            tokens.append(int(data[start:pos]))
+        width, height, maxval = tokens
+        if maxval != 255:
+            raise ValueError('only 8 bit PPM')
+        depth = 3
+        body = data[pos + 1:]
+    else:
+        raise ValueError('not a binary PPM or PAM')
+
+    pixels = []
+    for i in range(width * height):
+        px = body[i * depth:(i + 1) * depth]
+        pixels.append(tuple(px) if depth == 4 else tuple(px) + (255,))
+    return width, height, depth, pixels
+
+
+def upload(x, y, qoi):
+    return b'#q' + bytes([x, y]) + qoi
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('image', help='binary PPM or PAM')
+    parser.add_argument('output', nargs='?', help='.qoi file to write')
+    parser.add_argument('--port', help='send it to the board on this port instead')
+    parser.add_argument('--baud', type=int, default=9600)
+    parser.add_argument('--at', type=int, nargs=2, default=(0, 0), metavar=('X', 'Y'),
+                        help='where the top left corner goes on the panel')
+    args = parser.parse_args()
+
+    width, height, channels, pixels = read_netpbm(open(args.image, 'rb').read())
+    x, y = args.at
+    if x + width > PANEL or y + height > PANEL:
+        sys.exit('%dx%d at %d,%d is off the %dx%d panel' % (width, height, x, y, PANEL, PANEL))
+    qoi = encode(width, height, pixels, channels)
+    raw = width * height * 2
+    print('%dx%d: %d bytes, %.1f%% of raw RGB565, %.2f s on the line against %.2f s raw at %d baud' %
+          (width, height, len(qoi), 100.0 * len(qoi) / raw, len(qoi) * 10.0 / args.baud, raw * 10.0 / args.baud,
+           args.baud), file=sys.stderr)
+
+    if args.port:
+        import serial  # pyserial, only needed for a real port
+        port = serial.Serial(args.port, args.baud)
+        port.write(upload(x, y, qoi))
+        port.flush()
+    elif args.output:
+        open(args.output, 'wb').write(qoi)
+
+
+if __name__ == '__main__':
+    main()